@@ -6,11 +6,34 @@
 #ifndef SRC_MULTICASTUDP_H_
 #define SRC_MULTICASTUDP_H_
 
+#include <cstdint>
 #include <string>
 #include <memory>
+#include <vector>
 
 class MulticastUdpListener;
 
+/**
+ * @brief One classic BPF instruction. Same layout as struct sock_filter in linux/filter.h.
+ *
+ * Offset 0 of the program is the UDP header, the payload starts at offset 8.
+ */
+struct MulticastUdpFilterInstruction {
+	uint16_t code;	///< Opcode.
+	uint8_t jt;		///< Jump offset if true.
+	uint8_t jf;		///< Jump offset if false.
+	uint32_t k;		///< Generic field.
+};
+
+/**
+ * @brief Receive backend. Used in MulticastUdp::setReceiveBackend.
+ */
+enum MulticastUdpReceiveBackendEnum
+{
+	MulticastUdpReceiveBackend_Select, ///< select() and recvfrom() into an internal buffer.
+	MulticastUdpReceiveBackend_IoUring ///< io_uring multishot recvmsg into provided buffers. Falls back to Select when not supported.
+};
+
 /**
  * @brief MulticastUdp allows multicast UDP communication.
  *
@@ -88,13 +111,83 @@ public:
 	/**
 	 * @brief Receive data from the UDP Multicast socket
 	 *
+	 * A datagram longer than the buffer is dropped, counted in dropCount(), and the wait goes on for the rest
+	 * of the timeout.
+	 *
 	 * @param [out] buffer Pointer to the binary buffer to receive the message.
 	 * @param [in] size Size of the pointed buffer.
 	 *
-	 * @return On success, number of bytes received. On error, -1. On timeout, -2.
+	 * @return On success, number of bytes received, never more than size. On error, -1. On timeout, -2.
 	 */
 	int recv(void* buffer, std::size_t size);
 
+	/**
+	 * @brief Receive data into a library owned buffer
+	 *
+	 * Avoids copying the datagram into a caller buffer. With the io_uring backend the data is the buffer
+	 * the kernel wrote into.
+	 *
+	 * @param [out] data Pointer to the received message. Valid until the next call to receive(), recv() or close().
+	 *
+	 * @return On success, number of bytes received. On error, -1. On timeout, -2.
+	 */
+	int receive(const char*& data);
+
+	/**
+	 * @brief Select the receive backend.
+	 *
+	 * Takes effect on the next open(). When the io_uring backend is requested and the kernel does not support
+	 * it, the socket falls back to the select backend.
+	 *
+	 * @param [in] backend Requested backend. See enumeration MulticastUdpReceiveBackendEnum.
+	 */
+	void setReceiveBackend(MulticastUdpReceiveBackendEnum backend);
+
+	/**
+	 * @brief Get the receive backend in use.
+	 *
+	 * @return Backend in use when open, requested backend when closed.
+	 */
+	MulticastUdpReceiveBackendEnum getReceiveBackend();
+
+	/**
+	 * @brief Datagrams dropped by the kernel on this socket.
+	 *
+	 * Counts datagrams discarded because the socket receive buffer was full, and datagrams dropped because they
+	 * were larger than the receive buffer.
+	 *
+	 * @return Drops since the socket was opened, -1 if closed or not supported by the kernel.
+	 */
+	int64_t dropCount();
+
+	/**
+	 * @brief Receive only from the given senders.
+	 *
+	 * With a non empty list, open() joins the group once per sender with IP_ADD_SOURCE_MEMBERSHIP (source
+	 * specific multicast) instead of IP_ADD_MEMBERSHIP, and the kernel discards datagrams from other senders.
+	 * Takes effect on the next open().
+	 *
+	 * @param [in] sources Sender addresses, e.g. "192.168.1.10". Empty to receive from any sender.
+	 *
+	 * @return True on success, false if listening or if an address is not valid. The previous list is kept on
+	 * failure.
+	 */
+	bool setSourceFilter(const std::vector<std::string>& sources);
+
+	/**
+	 * @brief Attach a classic BPF program to the socket.
+	 *
+	 * The kernel runs the program on every datagram before it is queued, datagrams for which it returns 0
+	 * are discarded without waking the receiver. The program is attached now if the socket is open, and on
+	 * every later open(). Cannot be changed while listening.
+	 *
+	 * @param [in] program Instructions. Empty to detach the current program.
+	 *
+	 * @return True on success, false if listening or if the kernel rejects the program. The previous program
+	 * is kept on failure.
+	 */
+	bool setSocketFilter(const std::vector<MulticastUdpFilterInstruction>& program);
+
 	/**
 	 * @brief Set listener object.
 	 *
@@ -127,6 +220,7 @@ private:
 	std::unique_ptr<impl> pimpl;
 
 	void runListener();
+	bool attachSocketFilter();
 
 };
 
@@ -0,0 +1,424 @@
+/**
+*	@file NmeaAsyncMulticast.h
+*	@brief Header file for NmeaAsyncMulticast class
+*/
+
+#ifndef SRC_NMEAASYNCMULTICAST_H_
+#define SRC_NMEAASYNCMULTICAST_H_
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/ip/udp.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/version.hpp>
+
+#if BOOST_VERSION < 107000
+#error "NmeaAsyncMulticast requires Boost 1.70 or later (boost::asio::async_initiate)"
+#endif
+
+#include "NmeaDatagram.h"
+#include "NmeaMulticastUdp.h"
+
+/**
+ * @brief Storage for the intermediate handlers of one asynchronous operation.
+ *
+ * Handlers wrapped with nmeaBindHandlerMemory() allocate their intermediate state from this fixed block, so
+ * a steady stream of receive operations does not touch the heap. Requests that do not fit, or that arrive
+ * while the block is in use, fall back to operator new.
+ *
+ * Use one NmeaHandlerMemory per outstanding operation, e.g. one for receiving and one for sending.
+ */
+class NmeaHandlerMemory {
+public:
+	NmeaHandlerMemory() :
+			inUse(false) {
+	}
+
+	NmeaHandlerMemory(const NmeaHandlerMemory&) = delete;
+	NmeaHandlerMemory& operator=(const NmeaHandlerMemory&) = delete;
+
+	void* allocate(std::size_t size) {
+		if (!inUse && size <= sizeof(storage)) {
+			inUse = true;
+			return &storage;
+		}
+		return ::operator new(size);
+	}
+
+	void deallocate(void* pointer) {
+		if (pointer == &storage) {
+			inUse = false;
+		} else {
+			::operator delete(pointer);
+		}
+	}
+
+private:
+	std::aligned_storage<1024>::type storage;
+	bool inUse;
+};
+
+/**
+ * @brief Allocator over NmeaHandlerMemory, exposed to asio as the associated allocator of a handler.
+ */
+template<typename T>
+class NmeaHandlerAllocator {
+public:
+	typedef T value_type;
+
+	explicit NmeaHandlerAllocator(NmeaHandlerMemory& memory) :
+			memory(&memory) {
+	}
+
+	template<typename U>
+	NmeaHandlerAllocator(const NmeaHandlerAllocator<U>& other) :
+			memory(other.memory) {
+	}
+
+	T* allocate(std::size_t n) const {
+		return static_cast<T*>(memory->allocate(sizeof(T) * n));
+	}
+
+	void deallocate(T* pointer, std::size_t) const {
+		memory->deallocate(pointer);
+	}
+
+	bool operator==(const NmeaHandlerAllocator& other) const {
+		return memory == other.memory;
+	}
+
+	bool operator!=(const NmeaHandlerAllocator& other) const {
+		return memory != other.memory;
+	}
+
+private:
+	template<typename > friend class NmeaHandlerAllocator;
+
+	NmeaHandlerMemory* memory;
+};
+
+/**
+ * @brief Completion handler bound to a NmeaHandlerMemory. Created by nmeaBindHandlerMemory().
+ */
+template<typename Handler>
+class NmeaMemoryBoundHandler {
+public:
+	typedef NmeaHandlerAllocator<Handler> allocator_type;
+
+	NmeaMemoryBoundHandler(NmeaHandlerMemory& memory, Handler handler) :
+			memory(memory), handler(std::move(handler)) {
+	}
+
+	allocator_type get_allocator() const {
+		return allocator_type(memory);
+	}
+
+	template<typename ... Args>
+	void operator()(Args&&... args) {
+		handler(std::forward<Args>(args)...);
+	}
+
+private:
+	NmeaHandlerMemory& memory;
+	Handler handler;
+};
+
+/**
+ * @brief Bind a completion handler to a NmeaHandlerMemory.
+ *
+ * @param [in] memory Storage for the intermediate handlers. Must outlive the operation.
+ * @param [in] handler Completion handler.
+ *
+ * @return Handler to pass to NmeaAsyncMulticast asynchronous operations.
+ */
+template<typename Handler>
+inline NmeaMemoryBoundHandler<typename std::decay<Handler>::type> nmeaBindHandlerMemory(
+		NmeaHandlerMemory& memory, Handler&& handler) {
+	return NmeaMemoryBoundHandler<typename std::decay<Handler>::type>(memory,
+			std::forward<Handler>(handler));
+}
+
+template<typename Handler> class NmeaAsyncReceiveOp;
+template<typename Handler> class NmeaAsyncSendError;
+
+/**
+ * @brief NmeaAsyncMulticast implements the Nmea Ethernet protocol over a caller supplied asio socket.
+ *
+ * Runs on the caller io_context threads instead of owning a listening thread. The socket is supplied by the
+ * caller and can be prepared with joinGroup().
+ *
+ * Operations follow the asio universal model, any completion token can be used: a callback, a handler bound
+ * with nmeaBindHandlerMemory() for allocation free steady state, boost::asio::use_future or, with C++20
+ * coroutines, boost::asio::use_awaitable:
+ * @code
+ * std::size_t count = co_await nmea.async_receive_sentences(boost::asio::use_awaitable);
+ * for (std::size_t i = 0; i < count; ++i) {
+ *     const NmeaDatagramLine& line = nmea.sentence(i);
+ *     ...
+ * }
+ * co_await nmea.async_send_string("GP0001", "$GPHDT,123.4,T*00", boost::asio::use_awaitable);
+ * @endcode
+ *
+ * At most one receive and one send can be outstanding at a time.
+ */
+class NmeaAsyncMulticast {
+public:
+	/**
+	 * @brief Maximum number of sentences reported for one datagram.
+	 */
+	static const std::size_t MaxSentences = 32;
+
+	/**
+	 * @brief Constructor
+	 *
+	 * @param [in] socket Socket used to send and receive. Must outlive this object.
+	 * @param [in] transmissionGroup Transmission group used to talk and/or listen. See enumeration NmeaTrasmissionGroupEnum.
+	 */
+	NmeaAsyncMulticast(boost::asio::ip::udp::socket& socket,
+			NmeaTrasmissionGroupEnum transmissionGroup);
+
+	/**
+	 * @brief Open a socket and join a transmission group.
+	 *
+	 * Binds to the group port with address reuse and enables multicast loop, like NmeaMulticastUdp::open().
+	 *
+	 * @param [in] socket Socket to prepare. Opened if needed.
+	 * @param [in] transmissionGroup Transmission group to join. See enumeration NmeaTrasmissionGroupEnum.
+	 * @param [out] ec Error, if any.
+	 */
+	static void joinGroup(boost::asio::ip::udp::socket& socket,
+			NmeaTrasmissionGroupEnum transmissionGroup,
+			boost::system::error_code& ec);
+
+	/**
+	 * @brief Register a Source Id
+	 *
+	 * Register a System Id to be able to keep the messages counter when sending messages.
+	 *
+	 * @param sourceId
+	 */
+	void registerSystemId(const std::string& sourceId);
+
+	/**
+	 * @brief Receive the sentences of the next valid datagram.
+	 *
+	 * Datagrams without the "UdPbC" header or without sentences are skipped. On completion the sentences
+	 * are available through sentence() until the next receive is started.
+	 *
+	 * @param [in] token Completion token. Handler signature: void(boost::system::error_code ec, std::size_t count).
+	 */
+	template<typename ReceiveToken>
+	BOOST_ASIO_INITFN_AUTO_RESULT_TYPE(ReceiveToken, void(boost::system::error_code, std::size_t))
+	async_receive_sentences(ReceiveToken&& token) {
+		return boost::asio::async_initiate<ReceiveToken,
+				void(boost::system::error_code, std::size_t)>(
+				InitiateReceive { this }, token);
+	}
+
+	/**
+	 * @brief Send NMEA String to the transmission group
+	 *
+	 * The datagram is built in an internal buffer when the operation is initiated. Deferred tokens such as
+	 * use_awaitable keep a copy of the arguments, so they can be released as soon as this call returns.
+	 *
+	 * @param [in] sourceId Source Id to wrap around the NMEA sentence.
+	 * @param [in] nmea NMEA sentence to send.
+	 * @param [in] token Completion token. Handler signature: void(boost::system::error_code ec, std::size_t bytes).
+	 */
+	template<typename SendToken>
+	BOOST_ASIO_INITFN_AUTO_RESULT_TYPE(SendToken, void(boost::system::error_code, std::size_t))
+	async_send_string(const std::string& sourceId, const std::string& nmea,
+			SendToken&& token) {
+		return boost::asio::async_initiate<SendToken,
+				void(boost::system::error_code, std::size_t)>(
+				InitiateSend { this }, token, sourceId, nmea);
+	}
+
+	/**
+	 * @brief Sentence of the last received datagram.
+	 *
+	 * @param [in] index Sentence index, lower than the count reported by async_receive_sentences().
+	 *
+	 * @return Parsed sentence. Points into the receive buffer.
+	 */
+	const NmeaDatagramLine& sentence(std::size_t index) const {
+		return lines[index];
+	}
+
+	/**
+	 * @brief Sender of the last received datagram.
+	 */
+	const boost::asio::ip::udp::endpoint& sender() const {
+		return senderEndpoint;
+	}
+
+private:
+	template<typename > friend class NmeaAsyncReceiveOp;
+
+	boost::asio::ip::udp::socket& socket;
+	boost::asio::ip::udp::endpoint groupEndpoint;
+	boost::asio::ip::udp::endpoint senderEndpoint;
+
+	std::unordered_map<std::string, int> messageCounter;
+
+	std::array<NmeaDatagramLine, MaxSentences> lines;
+
+	char readbuffer[4096];
+	char writebuffer[4096];
+
+	std::size_t encode(const std::string& sourceId, const std::string& nmea);
+	std::size_t parse(std::size_t size);
+
+	struct InitiateReceive {
+		NmeaAsyncMulticast* self;
+
+		template<typename Handler>
+		void operator()(Handler&& handler) const {
+			NmeaAsyncReceiveOp<typename std::decay<Handler>::type>(self,
+					std::forward<Handler>(handler)).start();
+		}
+	};
+
+	struct InitiateSend {
+		NmeaAsyncMulticast* self;
+
+		template<typename Handler>
+		void operator()(Handler&& handler, const std::string& sourceId,
+				const std::string& nmea) const {
+			std::size_t size = self->encode(sourceId, nmea);
+			if (size == 0) {
+				// Report the error through the handler executor, never inline.
+				boost::asio::post(self->socket.get_executor(),
+						NmeaAsyncSendError<typename std::decay<Handler>::type>(
+								std::forward<Handler>(handler),
+								boost::asio::error::message_size));
+				return;
+			}
+			self->socket.async_send_to(
+					boost::asio::buffer(self->writebuffer, size),
+					self->groupEndpoint, std::forward<Handler>(handler));
+		}
+	};
+};
+
+/**
+ * @brief Composed operation behind NmeaAsyncMulticast::async_receive_sentences().
+ *
+ * Receives until a datagram with at least one sentence arrives, then calls the handler.
+ */
+template<typename Handler>
+class NmeaAsyncReceiveOp {
+public:
+	typedef typename boost::asio::associated_allocator<Handler>::type allocator_type;
+
+	NmeaAsyncReceiveOp(NmeaAsyncMulticast* self, Handler&& handler) :
+			self(self), handler(std::move(handler)) {
+	}
+
+	allocator_type get_allocator() const {
+		return boost::asio::get_associated_allocator(handler);
+	}
+
+	const Handler& getHandler() const {
+		return handler;
+	}
+
+	void start() {
+		NmeaAsyncMulticast* s = self;
+		s->socket.async_receive_from(
+				boost::asio::buffer(s->readbuffer, sizeof(s->readbuffer)),
+				s->senderEndpoint, std::move(*this));
+	}
+
+	void operator()(boost::system::error_code ec, std::size_t size) {
+		std::size_t count = 0;
+		if (!ec) {
+			count = self->parse(size);
+			if (count == 0) {
+				start();
+				return;
+			}
+		}
+		handler(ec, count);
+	}
+
+private:
+	NmeaAsyncMulticast* self;
+	Handler handler;
+};
+
+/**
+ * @brief Completion of NmeaAsyncMulticast::async_send_string() when the datagram cannot be built.
+ *
+ * Posted instead of a bound call so the user handler keeps its associated allocator and executor.
+ */
+template<typename Handler>
+class NmeaAsyncSendError {
+public:
+	typedef typename boost::asio::associated_allocator<Handler>::type allocator_type;
+
+	NmeaAsyncSendError(Handler&& handler, boost::system::error_code ec) :
+			handler(std::move(handler)), ec(ec) {
+	}
+
+	allocator_type get_allocator() const {
+		return boost::asio::get_associated_allocator(handler);
+	}
+
+	const Handler& getHandler() const {
+		return handler;
+	}
+
+	void operator()() {
+		handler(ec, std::size_t(0));
+	}
+
+private:
+	Handler handler;
+	boost::system::error_code ec;
+};
+
+namespace boost {
+namespace asio {
+
+/**
+ * @brief Forwards the executor of the user handler to the intermediate receive operations.
+ *
+ * Inherits from the handler association so a handler without its own executor keeps the allocation free
+ * fast path of the socket executor.
+ */
+template<typename Handler, typename Executor>
+struct associated_executor<NmeaAsyncReceiveOp<Handler>, Executor> :
+		associated_executor<Handler, Executor> {
+	static typename associated_executor<Handler, Executor>::type get(
+			const NmeaAsyncReceiveOp<Handler>& op,
+			const Executor& ex = Executor()) {
+		return associated_executor<Handler, Executor>::get(op.getHandler(), ex);
+	}
+};
+
+/**
+ * @brief Forwards the executor of the user handler to the posted send error.
+ */
+template<typename Handler, typename Executor>
+struct associated_executor<NmeaAsyncSendError<Handler>, Executor> :
+		associated_executor<Handler, Executor> {
+	static typename associated_executor<Handler, Executor>::type get(
+			const NmeaAsyncSendError<Handler>& op,
+			const Executor& ex = Executor()) {
+		return associated_executor<Handler, Executor>::get(op.getHandler(), ex);
+	}
+};
+
+} // namespace asio
+} // namespace boost
+
+#endif /* SRC_NMEAASYNCMULTICAST_H_ */
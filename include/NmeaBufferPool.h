@@ -0,0 +1,222 @@
+/**
+*	@file NmeaBufferPool.h
+*	@brief Header file for NmeaBufferPool and NmeaBuffer classes
+*/
+
+#ifndef SRC_NMEABUFFERPOOL_H_
+#define SRC_NMEABUFFERPOOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+class NmeaBufferPool;
+
+/**
+ * @brief Header of a pooled buffer. Internal to NmeaBufferPool and NmeaBuffer.
+ */
+struct NmeaBufferSlot {
+	std::atomic<uint32_t> references;	///< Number of NmeaBuffer handles.
+	std::atomic<uint32_t> next;			///< Next free slot while in the free list.
+	uint32_t index;						///< Position in the pool.
+	std::size_t size;					///< Bytes used.
+	char* data;							///< Start of the buffer in the slab.
+	NmeaBufferPool* pool;				///< Owner pool.
+};
+
+/**
+ * @brief Handle to a buffer of a NmeaBufferPool.
+ *
+ * The size of a pointer. Moving a handle is free, copying it increments the reference count of the
+ * buffer. The buffer goes back to its pool when the last handle is destroyed or reset.
+ *
+ * Handles can be passed between threads. The buffer contents must not be modified once shared.
+ */
+class NmeaBuffer {
+public:
+	/**
+	 * @brief Empty handle.
+	 */
+	NmeaBuffer() :
+			slot(nullptr) {
+	}
+
+	NmeaBuffer(const NmeaBuffer& other) :
+			slot(other.slot) {
+		if (slot != nullptr) {
+			slot->references.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	NmeaBuffer(NmeaBuffer&& other) :
+			slot(other.slot) {
+		other.slot = nullptr;
+	}
+
+	NmeaBuffer& operator=(NmeaBuffer other) {
+		std::swap(slot, other.slot);
+		return *this;
+	}
+
+	~NmeaBuffer() {
+		reset();
+	}
+
+	/**
+	 * @brief Release the buffer and leave the handle empty.
+	 */
+	void reset();
+
+	/**
+	 * @brief True if the handle holds a buffer.
+	 */
+	explicit operator bool() const {
+		return slot != nullptr;
+	}
+
+	/**
+	 * @brief Buffer contents.
+	 */
+	const char* data() const {
+		return slot->data;
+	}
+
+	/**
+	 * @brief Writable buffer contents. Only while the handle is not shared.
+	 */
+	char* data() {
+		return slot->data;
+	}
+
+	/**
+	 * @brief Bytes used.
+	 */
+	std::size_t size() const {
+		return slot->size;
+	}
+
+	/**
+	 * @brief Set the bytes used. Only while the handle is not shared.
+	 *
+	 * @param [in] size Bytes used, not greater than capacity().
+	 */
+	void resize(std::size_t size) {
+		slot->size = size;
+	}
+
+	/**
+	 * @brief Size of the buffer.
+	 */
+	std::size_t capacity() const;
+
+	/**
+	 * @brief Number of handles sharing the buffer.
+	 */
+	uint32_t useCount() const {
+		return (slot != nullptr) ?
+				slot->references.load(std::memory_order_relaxed) : 0;
+	}
+
+private:
+	friend class NmeaBufferPool;
+
+	explicit NmeaBuffer(NmeaBufferSlot* slot) :
+			slot(slot) {
+	}
+
+	NmeaBufferSlot* slot;
+};
+
+/**
+ * @brief Pool of fixed size buffers with reference counted handles.
+ *
+ * All buffers are carved from one slab allocated at construction, so acquiring and releasing never
+ * touch the heap. Free buffers are kept in a lock free list, handles can be released from any thread.
+ *
+ * Used by NmeaMulticastUdp::setBufferPool() so listeners can keep received datagrams without copying them.
+ * The pool must outlive every handle taken from it.
+ */
+class NmeaBufferPool {
+public:
+	/**
+	 * @brief Constructor
+	 *
+	 * @param [in] bufferCount Number of buffers.
+	 * @param [in] bufferSize Size of each buffer in bytes.
+	 */
+	NmeaBufferPool(std::size_t bufferCount, std::size_t bufferSize = 2048);
+
+	NmeaBufferPool(const NmeaBufferPool&) = delete;
+	NmeaBufferPool& operator=(const NmeaBufferPool&) = delete;
+
+	/**
+	 * @brief Destructor
+	 */
+	virtual ~NmeaBufferPool();
+
+	/**
+	 * @brief Take a free buffer.
+	 *
+	 * @return Handle with size 0, or an empty handle if every buffer is in use.
+	 */
+	NmeaBuffer acquire();
+
+	/**
+	 * @brief Number of buffers in the pool.
+	 */
+	std::size_t capacity() const;
+
+	/**
+	 * @brief Size of each buffer in bytes.
+	 */
+	std::size_t bufferSize() const;
+
+	/**
+	 * @brief Number of free buffers.
+	 */
+	std::size_t available() const;
+
+	/**
+	 * @brief Highest number of buffers in use at the same time.
+	 */
+	std::size_t peakInUse() const;
+
+	/**
+	 * @brief Number of acquire() calls that found the pool empty.
+	 */
+	uint64_t exhaustedCount() const;
+
+private:
+	friend class NmeaBuffer;
+
+	std::size_t count;
+	std::size_t size;
+	std::unique_ptr<NmeaBufferSlot[]> slots;
+	std::vector<char> slab;
+
+	// Free list head: slot index in the low half, ABA tag in the high half.
+	std::atomic<uint64_t> head;
+	std::atomic<std::size_t> freeCount;
+	std::atomic<std::size_t> peak;
+	std::atomic<uint64_t> exhausted;
+
+	void release(NmeaBufferSlot* slot);
+};
+
+inline void NmeaBuffer::reset() {
+	if (slot != nullptr) {
+		if (slot->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			slot->pool->release(slot);
+		}
+		slot = nullptr;
+	}
+}
+
+inline std::size_t NmeaBuffer::capacity() const {
+	return slot->pool->size;
+}
+
+#endif /* SRC_NMEABUFFERPOOL_H_ */
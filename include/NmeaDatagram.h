@@ -0,0 +1,186 @@
+/**
+*	@file NmeaDatagram.h
+*	@brief Header file for the NMEA datagram parser
+*/
+
+#ifndef SRC_NMEADATAGRAM_H_
+#define SRC_NMEADATAGRAM_H_
+
+#include <cstddef>
+
+#include "NmeaSentenceEncoder.h"
+
+/**
+ * @brief Size of the "UdPbC" datagram header, including the null terminator.
+ */
+const std::size_t NmeaDatagramHeaderSize = 6;
+
+/**
+ * @brief One line of a NMEA datagram.
+ *
+ * All pointers refer to the parsed buffer, nothing is copied. Strings are not null terminated.
+ */
+struct NmeaDatagramLine {
+	const char* tagBlock;		///< TAG block contents without the backslashes and checksum. Null if absent.
+	std::size_t tagBlockSize;	///< TAG block size.
+	const char* sourceId;		///< Value of the "s:" TAG block parameter. Null if absent.
+	std::size_t sourceIdSize;	///< Source Id size.
+	unsigned groupLine;			///< Line number within the sentence group, from the "g:" TAG block parameter. 0 if absent.
+	unsigned groupSize;			///< Number of lines of the sentence group. 0 if absent.
+	unsigned groupId;			///< Sentence group Id.
+	const char* sentence;		///< NMEA sentence without the line terminator.
+	std::size_t sentenceSize;	///< NMEA sentence size.
+};
+
+/**
+ * @brief Parser for datagrams defined in EN 61162-450:2011.
+ *
+ * Walks the lines of a "UdPbC" datagram in place, with no allocation. Each line is an optional TAG block
+ * followed by a sentence.
+ *
+ * Usage:
+ * @code
+ * NmeaDatagramReader reader(data, size);
+ * NmeaDatagramLine line;
+ * while (reader.next(line)) {
+ *     ...
+ * }
+ * @endcode
+ */
+class NmeaDatagramReader {
+public:
+	/**
+	 * @brief Constructor
+	 *
+	 * @param [in] data Pointer to the datagram, starting with the "UdPbC" header.
+	 * @param [in] size Size of the datagram.
+	 */
+	NmeaDatagramReader(const char* data, std::size_t size);
+
+	/**
+	 * @brief Verify the datagram header.
+	 *
+	 * @return True if the datagram starts with the "UdPbC" header.
+	 */
+	bool isValid() const;
+
+	/**
+	 * @brief Parse the next line.
+	 *
+	 * @param [out] line Parsed line.
+	 *
+	 * @return True if a line was parsed, false at the end of the datagram or if the header is not valid.
+	 */
+	bool next(NmeaDatagramLine& line);
+
+private:
+	const char* current;
+	const char* end;
+	bool valid;
+};
+
+/**
+ * @brief Writer for datagrams defined in EN 61162-450:2011.
+ *
+ * Builds a "UdPbC" datagram in a caller buffer, with no allocation. The TAG block is formatted by hand and
+ * its checksum computed while writing.
+ *
+ * Usage:
+ * @code
+ * NmeaDatagramWriter writer(buffer, sizeof(buffer));
+ * writer.writeTagBlock("GP0001", 6, counter);
+ * writer.writeSentence(nmea.data(), nmea.size());
+ * send(buffer, writer.size());
+ * @endcode
+ */
+class NmeaDatagramWriter {
+public:
+	/**
+	 * @brief Constructor
+	 *
+	 * Writes the "UdPbC" header.
+	 *
+	 * @param [in] buffer Destination buffer.
+	 * @param [in] capacity Size of the destination buffer.
+	 */
+	NmeaDatagramWriter(char* buffer, std::size_t capacity);
+
+	/**
+	 * @brief Write a TAG block with source Id and line count parameters.
+	 *
+	 * @param [in] sourceId Source Id, e.g. "GP0001".
+	 * @param [in] sourceIdSize Source Id size.
+	 * @param [in] lineCount Value of the "n:" parameter.
+	 *
+	 * @return True on success, false if the buffer is too small.
+	 */
+	bool writeTagBlock(const char* sourceId, std::size_t sourceIdSize,
+			unsigned lineCount);
+
+	/**
+	 * @brief Size of the TAG block written by writeTagBlock().
+	 *
+	 * Allows to place the header and TAG block right before a sentence already in a buffer.
+	 *
+	 * @param [in] sourceIdSize Source Id size.
+	 * @param [in] lineCount Value of the "n:" parameter.
+	 *
+	 * @return TAG block size, including both backslashes.
+	 */
+	static std::size_t tagBlockSize(std::size_t sourceIdSize, unsigned lineCount);
+
+	/**
+	 * @brief Write a sentence followed by the line terminator.
+	 *
+	 * @param [in] sentence NMEA sentence.
+	 * @param [in] sentenceSize NMEA sentence size.
+	 *
+	 * @return True on success, false if the buffer is too small.
+	 */
+	bool writeSentence(const char* sentence, std::size_t sentenceSize);
+
+	/**
+	 * @brief Encode a typed sentence in place, followed by the line terminator.
+	 *
+	 * The sentence is formatted straight into the datagram buffer, see NmeaSentenceEncoder.h.
+	 *
+	 * @param [in] talker Two character talker identifier, e.g. "HE".
+	 * @param [in] sentence Sentence contents, any type with a nmeaEncode() overload, e.g. NmeaTrueHeading.
+	 *
+	 * @return True on success, false if the buffer is too small.
+	 */
+	template<typename Sentence>
+	bool encodeSentence(const char* talker, const Sentence& sentence) {
+		std::size_t sentenceSize = 0;
+		if (valid && capacity - position > 2) {
+			sentenceSize = nmeaEncode(&buffer[position], capacity - position - 2,
+					talker, sentence);
+		}
+		if (sentenceSize == 0) {
+			valid = false;
+			return false;
+		}
+		position += sentenceSize;
+		buffer[position++] = '\r';
+		buffer[position++] = '\n';
+		return true;
+	}
+
+	/**
+	 * @brief Number of bytes written.
+	 */
+	std::size_t size() const;
+
+	/**
+	 * @brief False if any write did not fit in the buffer.
+	 */
+	bool isValid() const;
+
+private:
+	char* buffer;
+	std::size_t capacity;
+	std::size_t position;
+	bool valid;
+};
+
+#endif /* SRC_NMEADATAGRAM_H_ */
@@ -0,0 +1,151 @@
+/**
+*	@file NmeaLatestValueCache.h
+*	@brief Header file for NmeaLatestValueCache class
+*/
+
+#ifndef SRC_NMEALATESTVALUECACHE_H_
+#define SRC_NMEALATESTVALUECACHE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+/**
+ * @brief Maximum length of a cached NMEA sentence, longer sentences are truncated.
+ */
+const std::size_t NmeaLatestValueMaxSentence = 128;
+
+/**
+ * @brief Snapshot of a cached NMEA sentence.
+ *
+ * Plain value filled by NmeaLatestValueCache::snapshot(). Holds copies of the data, so it remains
+ * valid no matter what the writer does afterwards.
+ */
+struct NmeaLatestValue {
+	char sourceId[8];							///< Null terminated source Id, e.g. "GP0001".
+	char address[8];							///< Null terminated talker and formatter, e.g. "GPHDT".
+	char sentence[NmeaLatestValueMaxSentence];	///< Null terminated NMEA sentence.
+	std::size_t length;							///< Length of the sentence without terminator.
+	std::chrono::steady_clock::time_point received;	///< Time the sentence was stored.
+};
+
+/**
+ * @brief Latest value store for NMEA sentences.
+ *
+ * Keeps the most recent sentence for each (source Id, talker + formatter) pair in a fixed capacity flat
+ * table. Slots are claimed the first time a key is seen and are never released, when the table is full
+ * new keys are counted and ignored.
+ *
+ * Each slot is protected by a sequence lock. Any number of reader threads can take snapshots without locks,
+ * allocations or callbacks, they retry only when they overlap with a write on the same slot. Writers are
+ * serialized between them so several NmeaMulticastUdp objects can feed the same cache.
+ *
+ * Usage: create the cache, pass it to NmeaMulticastUdp::setLatestValueCache() and poll snapshot() or age().
+ */
+class NmeaLatestValueCache {
+public:
+	/**
+	 * @brief Constructor
+	 *
+	 * @param [in] capacity Maximum number of distinct keys. Rounded up to a power of two.
+	 */
+	explicit NmeaLatestValueCache(std::size_t capacity = 256);
+
+	/**
+	 * @brief Destructor
+	 */
+	virtual ~NmeaLatestValueCache();
+
+	/**
+	 * @brief Store a sentence.
+	 *
+	 * The key is built from the source Id and the address field of the sentence (the five characters
+	 * following '$' or '!').
+	 *
+	 * @param [in] sourceId Source Id of the sentence.
+	 * @param [in] nmea NMEA sentence.
+	 *
+	 * @return True if stored, false if the sentence has no address field or the table is full.
+	 */
+	bool update(const std::string& sourceId, const std::string& nmea);
+
+	/**
+	 * @brief Read the latest sentence for a key.
+	 *
+	 * Lock free and allocation free.
+	 *
+	 * @param [in] sourceId Source Id, e.g. "GP0001".
+	 * @param [in] address Talker and formatter, e.g. "GPHDT".
+	 * @param [out] value Copy of the latest value.
+	 *
+	 * @return True if a value exists for the key.
+	 */
+	bool snapshot(const std::string& sourceId, const std::string& address,
+			NmeaLatestValue& value) const;
+
+	/**
+	 * @brief Read the latest sentence stored in a slot.
+	 *
+	 * Allows readers to scan every key, for instance to look for stale sensors.
+	 *
+	 * @param [in] index Slot index, from 0 to capacity() - 1.
+	 * @param [out] value Copy of the latest value.
+	 *
+	 * @return True if the slot is in use.
+	 */
+	bool snapshotAt(std::size_t index, NmeaLatestValue& value) const;
+
+	/**
+	 * @brief Time elapsed since a key was last updated.
+	 *
+	 * @param [in] sourceId Source Id, e.g. "GP0001".
+	 * @param [in] address Talker and formatter, e.g. "GPHDT".
+	 * @param [out] age Time since the last update.
+	 *
+	 * @return True if a value exists for the key.
+	 */
+	bool age(const std::string& sourceId, const std::string& address,
+			std::chrono::steady_clock::duration& age) const;
+
+	/**
+	 * @brief Time elapsed since a slot was last updated.
+	 *
+	 * @param [in] index Slot index, from 0 to capacity() - 1.
+	 * @param [out] age Time since the last update.
+	 *
+	 * @return True if the slot is in use.
+	 */
+	bool ageAt(std::size_t index, std::chrono::steady_clock::duration& age) const;
+
+	/**
+	 * @brief Number of slots in the table.
+	 */
+	std::size_t capacity() const;
+
+	/**
+	 * @brief Number of keys stored.
+	 */
+	std::size_t size() const;
+
+	/**
+	 * @brief Number of updates rejected because the table was full.
+	 */
+	uint64_t overflows() const;
+
+private:
+	struct Slot;
+
+	std::size_t mask;
+	std::unique_ptr<Slot[]> slots;
+	std::atomic<std::size_t> used;
+	std::atomic<uint64_t> overflowCount;
+	std::mutex writerMutex;
+
+	const Slot* find(const char* key, std::size_t keyLen) const;
+	bool read(const Slot& slot, NmeaLatestValue& value) const;
+};
+
+#endif /* SRC_NMEALATESTVALUECACHE_H_ */
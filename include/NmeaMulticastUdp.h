@@ -6,8 +6,15 @@
 #ifndef SRC_NMEAMULTICASTUDP_H_
 #define SRC_NMEAMULTICASTUDP_H_
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
+
+#include "MulticastUdp.h"
+#include "NmeaDatagram.h"
+#include "NmeaSentenceEncoder.h"
 
 /**
  * @brief NMEA transmission group indicator. Used in NmeaMulticastUdp constructor.
@@ -35,7 +42,19 @@ enum NmeaTrasmissionGroupEnum
 	NmeaTransmissionGroup_USR8  ///< User defined transmission group 8.
 };
 
+/**
+ * @brief Delivery mode for the listening thread. Used in NmeaMulticastUdp::setDeliveryMode.
+ */
+enum NmeaDeliveryModeEnum
+{
+	NmeaDeliveryMode_Direct,   ///< Every string is delivered to the listener from the receiving thread.
+	NmeaDeliveryMode_Conflated ///< Only the newest string per source Id and formatter is delivered, from a dispatch thread.
+};
+
 class NmeaMulticastUdpListener;
+class NmeaLatestValueCache;
+class NmeaBufferPool;
+class NmeaStatistics;
 
 /**
  * @brief NmeaMulticastUdp class implements Nmea Ethernet protocol.
@@ -94,6 +113,22 @@ public:
 	 */
 	bool isOpen();
 
+	/**
+	 * @brief Select the receive backend.
+	 *
+	 * Takes effect on the next open(). See MulticastUdp::setReceiveBackend.
+	 *
+	 * @param [in] backend Requested backend. See enumeration MulticastUdpReceiveBackendEnum.
+	 */
+	void setReceiveBackend(MulticastUdpReceiveBackendEnum backend);
+
+	/**
+	 * @brief Get the receive backend in use.
+	 *
+	 * @return Backend in use when open, requested backend when closed.
+	 */
+	MulticastUdpReceiveBackendEnum getReceiveBackend();
+
 	/**
 	 * @brief Register a Source Id
 	 *
@@ -113,6 +148,30 @@ public:
 	 */
 	bool sendString(const std::string& sourceId, const std::string& nmea);
 
+	/**
+	 * @brief Send a typed NMEA sentence to the transmission group
+	 *
+	 * The sentence is encoded straight into the datagram buffer after the TAG block, no string is built.
+	 *
+	 * @code
+	 * NmeaTrueHeading heading = { 123.45 };
+	 * multicast.sendSentence("HE0001", "HE", heading);
+	 * @endcode
+	 *
+	 * @param [in] sourceId Source Id to wrap around the NMEA sentence.
+	 * @param [in] talker Two character talker identifier, e.g. "HE".
+	 * @param [in] sentence Sentence contents, see NmeaSentenceEncoder.h.
+	 *
+	 * @return True on success, False on failure.
+	 */
+	template<typename Sentence>
+	bool sendSentence(const std::string& sourceId, const char* talker,
+			const Sentence& sentence) {
+		NmeaDatagramWriter writer = startDatagram(sourceId);
+		writer.encodeSentence(talker, sentence);
+		return sendDatagram(writer);
+	}
+
 	/**
 	 * @brief Receive NMEA String from the transmission group
 	 *
@@ -140,6 +199,158 @@ public:
 	 */
     void unsetListener();
 
+	/**
+	 * @brief Set latest value cache.
+	 *
+	 * Every valid string received by the listening thread is stored in the cache before the listener is
+	 * called. The listening thread can be started with only a cache and no listener.
+	 *
+	 * @param cache Smart pointer to the cache object. Can be shared between several NmeaMulticastUdp objects.
+	 */
+    void setLatestValueCache(std::shared_ptr<NmeaLatestValueCache> cache);
+
+	/**
+	 * @brief Unset latest value cache.
+	 *
+	 * Clear the cache pointer assignment.
+	 *
+	 */
+    void unsetLatestValueCache();
+
+	/**
+	 * @brief Set buffer pool.
+	 *
+	 * The listening thread receives each datagram straight into a buffer of the pool and passes the listener
+	 * a reference counted handle through NmeaMulticastUdpListener::onDatagramAvailable, so the listener can
+	 * keep it without copying. When every buffer is in use the datagram is read and dropped, see
+	 * poolDroppedCount(). A datagram longer than a buffer is dropped as well, by MulticastUdp::recv() when it
+	 * is received straight into the pool, which counts it with the kernel drops.
+	 *
+	 * Ignored in conflated delivery mode and with group assembly. Must be called before startListening().
+	 *
+	 * @param pool Smart pointer to the pool. Must outlive the handles given to the listener.
+	 */
+    void setBufferPool(std::shared_ptr<NmeaBufferPool> pool);
+
+	/**
+	 * @brief Unset buffer pool.
+	 *
+	 * Clear the pool pointer assignment.
+	 *
+	 */
+    void unsetBufferPool();
+
+	/**
+	 * @brief Set statistics publisher.
+	 *
+	 * The listening thread publishes datagram, byte, sentence, drop and parse error counters, per source Id
+	 * counters and the time spent in the listener into the block of this transmission group. Updates are
+	 * lock free and allocation free, the kernel drop counter is polled every few hundred datagrams and on
+	 * timeouts.
+	 *
+	 * Must be called before startListening().
+	 *
+	 * @param statistics Smart pointer to an open publisher. Can be shared between NmeaMulticastUdp objects of different transmission groups.
+	 *
+	 * @return True on success, false if listening or if another NmeaMulticastUdp object already publishes this
+	 * transmission group through the same publisher.
+	 */
+    bool setStatistics(std::shared_ptr<NmeaStatistics> statistics);
+
+	/**
+	 * @brief Unset statistics publisher.
+	 *
+	 * Clear the publisher pointer assignment and release the transmission group in the publisher.
+	 *
+	 */
+    void unsetStatistics();
+
+	/**
+	 * @brief Set delivery mode.
+	 *
+	 * In conflated mode the receiving thread stores each string in a slot keyed by source Id and
+	 * talker + formatter, keeping only the newest value. A dispatch thread delivers every changed key at most
+	 * once per cycle, so a slow listener skips stale values instead of making the socket buffer overflow.
+	 * Memory use is bounded by maxKeys, strings for new keys beyond that limit are dropped.
+	 *
+	 * Must be called before startListening().
+	 *
+	 * @param [in] mode Delivery mode. See enumeration NmeaDeliveryModeEnum.
+	 * @param [in] maxKeys Maximum number of keys kept in conflated mode.
+	 */
+    void setDeliveryMode(NmeaDeliveryModeEnum mode, std::size_t maxKeys = 256);
+
+	/**
+	 * @brief Number of strings overwritten by a newer value before they were delivered in conflated mode.
+	 */
+    uint64_t conflatedCount();
+
+	/**
+	 * @brief Number of strings dropped in conflated mode because the key limit was reached.
+	 */
+    uint64_t conflationOverflowCount();
+
+	/**
+	 * @brief Receive only from the given senders.
+	 *
+	 * Joins the transmission group with source specific multicast, see MulticastUdp::setSourceFilter.
+	 * Takes effect on the next open() or startListening().
+	 *
+	 * @param [in] sources Sender addresses, e.g. "192.168.1.10". Empty to receive from any sender.
+	 *
+	 * @return True on success, false if listening or if an address is not valid.
+	 */
+    bool setSourceFilter(const std::vector<std::string>& sources);
+
+	/**
+	 * @brief Enable or disable the kernel side sentence filter.
+	 *
+	 * When enabled, a BPF program attached to the socket discards in the kernel every datagram without the
+	 * "UdPbC" header and, if formatters are given, every datagram whose first sentence has another formatter.
+	 * Discarded datagrams neither wake the receiving thread nor are copied. The TAG block of the first line
+	 * must not exceed 80 characters. Applies immediately if open and on every later open(). Cannot be changed
+	 * while listening.
+	 *
+	 * @param [in] enable True to filter.
+	 * @param [in] formatters Accepted formatters, e.g. { "HDT", "THS" }, any talker. Empty to check only the header.
+	 *
+	 * @return True on success, false if listening, if a formatter is not three characters long or if the
+	 * kernel rejects the program.
+	 */
+    bool setKernelFilter(bool enable,
+    		const std::vector<std::string>& formatters = std::vector<std::string>());
+
+	/**
+	 * @brief Enable or disable sentence group assembly.
+	 *
+	 * When enabled, the listening thread processes every line of each datagram. Lines with a "g:" TAG block
+	 * parameter are collected until the group is complete and then delivered with a single
+	 * NmeaMulticastUdpListener::onGroupAvailable call from the receiving thread. Groups are assembled in a pool
+	 * of slots allocated by startListening(). Groups not completed within the timeout, or evicted because every
+	 * slot is busy, are dropped.
+	 *
+	 * Must be called before startListening(). Not available in conflated delivery mode, where the listener
+	 * runs on the dispatch thread: startListening() fails if both are enabled.
+	 *
+	 * @param [in] enable True to assemble groups.
+	 * @param [in] slots Maximum number of groups assembled at the same time.
+	 * @param [in] timeout Maximum time in milliseconds between the first and the last line of a group.
+	 *
+	 * @return False if listening, or if enabling with no slots or a timeout that is not positive.
+	 */
+    bool setGroupAssembly(bool enable, std::size_t slots = 16, int timeout = 1000);
+
+	/**
+	 * @brief Number of incomplete sentence groups dropped by timeout or eviction.
+	 */
+    uint64_t groupDroppedCount();
+
+	/**
+	 * @brief Number of datagrams dropped by the pooled listener because every buffer was in use, or because
+	 * the datagram received while the pool was exhausted did not fit in the buffer released meanwhile.
+	 */
+    uint64_t poolDroppedCount();
+
 	/**
 	 * @brief Starts the listening thread.
 	 */
@@ -150,11 +361,39 @@ public:
 	 */
     void stopListening();
 
+	/**
+	 * @brief Multicast address of a transmission group.
+	 *
+	 * @param [in] transmissionGroup Transmission group. See enumeration NmeaTrasmissionGroupEnum.
+	 *
+	 * @return Multicast address, e.g. "239.192.0.3".
+	 */
+    static std::string transmissionGroupAddress(NmeaTrasmissionGroupEnum transmissionGroup);
+
+	/**
+	 * @brief UDP port of a transmission group.
+	 *
+	 * @param [in] transmissionGroup Transmission group. See enumeration NmeaTrasmissionGroupEnum.
+	 *
+	 * @return UDP port, e.g. 60003.
+	 */
+    static int transmissionGroupPort(NmeaTrasmissionGroupEnum transmissionGroup);
+
 private:
     class impl;
     std::unique_ptr<impl> pimpl;
 
+    NmeaDatagramWriter startDatagram(const std::string& sourceId);
+    bool sendDatagram(const NmeaDatagramWriter& writer);
     void runListener();
+    void runDispatcher();
+    void conflate(const std::string& sourceId, const std::string& nmea);
+    void deliver(const std::string& sourceId, const std::string& nmea, bool conflated);
+    void runGroupListener();
+    void runPooledListener();
+    void dropPooled();
+    void recordReceive(int len, bool valid);
+    void recordDelivery(std::chrono::steady_clock::time_point start);
 
     static int16_t calculateNmeaChecksum(const std::string& nmeaStr);
 
@@ -6,6 +6,12 @@
 #ifndef SRC_NMEAMULTICASTUDPLISTENER_H_
 #define SRC_NMEAMULTICASTUDPLISTENER_H_
 
+#include <cstddef>
+#include <string>
+
+#include "NmeaBufferPool.h"
+#include "NmeaDatagram.h"
+
 /**
  * @brief Interface class for listening to NmeaMulticastUdp
  *
@@ -49,8 +55,55 @@ public:
      * Called by NmeaMulticastUdp class when a string arrives but the checksum does not match.
      */
     virtual void onChecksumError() = 0;
+
+    /**
+     * @brief On sentence group available event.
+     *
+     * Called by NmeaMulticastUdp class, when group assembly is enabled, once all the lines of a "g:" TAG block
+     * group have arrived. The default implementation calls onStringAvailable() for each sentence.
+     *
+     * @param [in] sourceId Source Id from arriving group.
+     * @param [in] block Sentences of the group in line order, each one terminated by "\r\n". Valid only during the call.
+     * @param [in] size Size of the block in bytes.
+     * @param [in] lines Number of sentences in the block.
+     */
+    virtual void onGroupAvailable(const std::string& sourceId, const char* block, std::size_t size, std::size_t lines);
+
+    /**
+     * @brief On datagram available event.
+     *
+     * Called by NmeaMulticastUdp class, when a buffer pool is set, for each valid datagram. The handle can be
+     * moved or copied to keep the datagram after the call returns, without copying its contents; the buffer
+     * goes back to the pool when the last handle is released. Parse it with NmeaDatagramReader.
+     * The default implementation calls onStringAvailable() for each sentence.
+     *
+     * @param [in] datagram Handle to the received datagram, including the "UdPbC" header.
+     */
+    virtual void onDatagramAvailable(NmeaBuffer datagram);
 };
 
 inline NmeaMulticastUdpListener::~NmeaMulticastUdpListener() { };
 
+inline void NmeaMulticastUdpListener::onGroupAvailable(const std::string& sourceId, const char* block,
+		std::size_t size, std::size_t) {
+	const char* end = block + size;
+	while (block < end) {
+		const char* lineEnd = block;
+		while (lineEnd < end && *lineEnd != '\r') {
+			++lineEnd;
+		}
+		onStringAvailable(sourceId, std::string(block, lineEnd));
+		block = lineEnd + 2;
+	}
+}
+
+inline void NmeaMulticastUdpListener::onDatagramAvailable(NmeaBuffer datagram) {
+	NmeaDatagramReader reader(datagram.data(), datagram.size());
+	NmeaDatagramLine line;
+	while (reader.next(line)) {
+		onStringAvailable(std::string(line.sourceId, line.sourceIdSize),
+				std::string(line.sentence, line.sentenceSize));
+	}
+}
+
 #endif /* SRC_NMEAMULTICASTUDPLISTENER_H_ */
@@ -0,0 +1,120 @@
+/**
+*	@file NmeaPassiveCapture.h
+*	@brief Header file for NmeaPassiveCapture class
+*/
+
+#ifndef SRC_NMEAPASSIVECAPTURE_H_
+#define SRC_NMEAPASSIVECAPTURE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+class NmeaPassiveCaptureListener;
+
+/**
+ * @brief NmeaPassiveCapture observes every NMEA transmission group without joining them.
+ *
+ * Intended for VDR and network monitoring equipment. Opens a single AF_PACKET socket with a TPACKET_V3
+ * memory mapped receive ring on one interface. A kernel filter keeps only unfragmented UDP datagrams sent to
+ * the transmission groups of NmeaTrasmissionGroupEnum, and the datagram parser reads them straight from the
+ * mapped frames, no datagram is copied. Each sentence handed to the listener is copied once into a string
+ * reused between calls. One thread serves all groups.
+ *
+ * Does not join the multicast groups, the traffic must reach the interface by other means (e.g. a mirror
+ * port or another process joined to the groups). Requires CAP_NET_RAW.
+ *
+ * To test on the loopback interface route the groups through it:
+ * @code
+ * ip route add 239.192.0.0/24 dev lo
+ * @endcode
+ * Only received frames are reported, the copies of frames sent by this host are ignored.
+ */
+class NmeaPassiveCapture {
+public:
+	/**
+	 * @brief Constructor
+	 *
+	 * @param [in] interfaceName Name of the interface to capture from, e.g. "eth0" or "lo".
+	 * @param [in] blockSize Size of each ring block in bytes. Must be a multiple of the page size.
+	 * @param [in] blockCount Number of ring blocks.
+	 * @param [in] timeout Timeout in milliseconds.
+	 */
+	NmeaPassiveCapture(const std::string& interfaceName,
+			std::size_t blockSize = 1 << 18, unsigned blockCount = 16,
+			int timeout = 1000);
+
+	/**
+	 * @brief Destructor
+	 */
+	virtual ~NmeaPassiveCapture();
+
+	/**
+	 * @brief Open the capture socket and map the receive ring.
+	 *
+	 * @return True on success, false on failure or if the socket was already open.
+	 */
+	bool open();
+
+	/**
+	 * @brief Close the capture socket.
+	 *
+	 * Also stops the listening thread.
+	 *
+	 * @return True on success, false if socket was already closed.
+	 */
+	bool close();
+
+	/**
+	 * @brief Verify if the socket is open.
+	 *
+	 * @return True if the socket is open. False if the socket is closed.
+	 */
+	bool isOpen();
+
+	/**
+	 * @brief Set listener object.
+	 *
+	 * @param listener Smart pointer to the listener object.
+	 */
+	void setListener(std::shared_ptr<NmeaPassiveCaptureListener> listener);
+
+	/**
+	 * @brief Unset listener object.
+	 */
+	void unsetListener();
+
+	/**
+	 * @brief Starts the listening thread.
+	 *
+	 * Opens the socket if needed.
+	 *
+	 * @return True if the thread was started.
+	 */
+	bool startListening();
+
+	/**
+	 * @brief Stops the listening thread.
+	 */
+	void stopListening();
+
+	/**
+	 * @brief Number of datagrams captured since open.
+	 */
+	uint64_t capturedCount();
+
+	/**
+	 * @brief Number of frames dropped by the kernel because the ring was full since open.
+	 */
+	uint64_t droppedCount();
+
+private:
+	class impl;
+	std::unique_ptr<impl> pimpl;
+
+	void runListener();
+	void processBlock(void* block);
+	void processFrame(const char* frame, std::size_t size);
+};
+
+#endif /* SRC_NMEAPASSIVECAPTURE_H_ */
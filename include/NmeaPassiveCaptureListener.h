@@ -0,0 +1,55 @@
+/**
+*	@file NmeaPassiveCaptureListener.h
+*	@brief Header file for NmeaPassiveCaptureListener class
+*/
+
+#ifndef SRC_NMEAPASSIVECAPTURELISTENER_H_
+#define SRC_NMEAPASSIVECAPTURELISTENER_H_
+
+#include <string>
+
+#include "NmeaMulticastUdp.h"
+
+/**
+ * @brief Interface class for listening to NmeaPassiveCapture
+ *
+ * Interface class for listening to NmeaPassiveCapture events.
+ */
+class NmeaPassiveCaptureListener {
+public:
+	/**
+	 * Destructor
+	 */
+	virtual ~NmeaPassiveCaptureListener();
+
+	/**
+	 * @brief On string available event.
+	 *
+	 * Called by NmeaPassiveCapture class for every sentence of a captured datagram.
+	 *
+	 * @param [in] transmissionGroup Transmission group the datagram was sent to.
+	 * @param [in] sourceId Source Id from the sentence TAG block.
+	 * @param [in] nmea NMEA string.
+	 */
+    virtual void onStringAvailable(NmeaTrasmissionGroupEnum transmissionGroup,
+    		const std::string& sourceId, const std::string& nmea) = 0;
+
+    /**
+     * @brief Timeout event.
+     *
+     * Called by NmeaPassiveCapture class when no datagram was captured during the timeout period.
+     *
+     */
+    virtual void onTimeout() = 0;
+
+    /**
+     * @brief On connection error event.
+     *
+     * Called by NmeaPassiveCapture class when an error is reported by the capture socket.
+     */
+    virtual void onConnectionError() = 0;
+};
+
+inline NmeaPassiveCaptureListener::~NmeaPassiveCaptureListener() { };
+
+#endif /* SRC_NMEAPASSIVECAPTURELISTENER_H_ */
@@ -0,0 +1,125 @@
+/**
+*	@file NmeaRelay.h
+*	@brief Header file for NmeaRelay class
+*/
+
+#ifndef SRC_NMEARELAY_H_
+#define SRC_NMEARELAY_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "NmeaMulticastUdp.h"
+
+/**
+ * @brief Maximum length of the source Id written by NmeaRelay.
+ */
+const std::size_t NmeaRelayMaxSourceId = 16;
+
+/**
+ * @brief Forwarding rule for NmeaRelay.
+ *
+ * A sentence received on sourceGroup is forwarded to targetGroup when its address and source Id match.
+ */
+struct NmeaRelayRule {
+	NmeaTrasmissionGroupEnum sourceGroup;	///< Transmission group to listen to.
+	std::string address;		///< Talker and formatter to match, e.g. "GPHDT". '?' matches any character, e.g. "??HDT". Empty matches every sentence.
+	std::string sourceId;		///< Source Id to match, e.g. "GP0001". Empty matches every source.
+	double maxRate;				///< Maximum sentences per second forwarded by this rule, extra sentences are skipped. 0 for no limit.
+	NmeaTrasmissionGroupEnum targetGroup;	///< Transmission group to forward to. Must differ from sourceGroup.
+	std::string newSourceId;	///< Source Id written in the forwarded TAG block. Empty keeps the received one.
+};
+
+/**
+ * @brief NmeaRelay republishes selected sentences from one transmission group onto another.
+ *
+ * A gateway that listens to SATD and NAVD and feeds a decimated subset to USR1 only needs a few rules:
+ * @code
+ * NmeaRelay relay;
+ * relay.addRule({ NmeaTransmissionGroup_SATD, "??HDT", "", 1.0, NmeaTransmissionGroup_USR1, "GW0001" });
+ * relay.addRule({ NmeaTransmissionGroup_NAVD, "GPGGA", "GP0001", 0, NmeaTransmissionGroup_USR1, "" });
+ * relay.start();
+ * @endcode
+ *
+ * There is one receiving thread per source group. Datagrams are received into a buffer with head room and
+ * every matching sentence is sent straight from that buffer: a new "UdPbC" header and TAG block are written
+ * over the bytes preceding the sentence, no string is built. The "n:" parameter of the forwarded TAG block
+ * counts the sentences sent with each source Id on each target group, across rules and source groups. A rate
+ * limited rule forwards a sentence only if at least 1 / maxRate seconds elapsed since the last one it forwarded.
+ *
+ * The relay also receives what it forwards, so rules must not form a cycle between groups, e.g. SATD to USR1
+ * and USR1 to SATD would forward the same sentences forever. addRule() rejects such rules.
+ */
+class NmeaRelay {
+public:
+	/**
+	 * @brief Constructor
+	 */
+	NmeaRelay();
+
+	/**
+	 * @brief Destructor
+	 */
+	virtual ~NmeaRelay();
+
+	/**
+	 * @brief Add a forwarding rule.
+	 *
+	 * Must be called before start().
+	 *
+	 * @param [in] rule Rule to add.
+	 *
+	 * @return True on success. False if the relay is running, source and target groups are equal, the address
+	 * is longer than 5 characters, the new source Id is longer than NmeaRelayMaxSourceId or the rule closes a
+	 * cycle with the rules already added.
+	 */
+	bool addRule(const NmeaRelayRule& rule);
+
+	/**
+	 * @brief Remove every rule. Must be called before start().
+	 */
+	void clearRules();
+
+	/**
+	 * @brief Open the sockets and start one receiving thread per source group.
+	 *
+	 * @return True on success, false if already running, without rules or if a socket cannot be opened.
+	 */
+	bool start();
+
+	/**
+	 * @brief Stop the receiving threads and close the sockets.
+	 */
+	void stop();
+
+	/**
+	 * @brief Verify if the relay is running.
+	 */
+	bool isRunning();
+
+	/**
+	 * @brief Number of sentences forwarded.
+	 */
+	uint64_t forwardedCount();
+
+	/**
+	 * @brief Number of matching sentences skipped by the rate limit.
+	 */
+	uint64_t rateLimitedCount();
+
+	/**
+	 * @brief Number of matching sentences not forwarded because the source Id was too long or the send failed.
+	 */
+	uint64_t droppedCount();
+
+private:
+	class impl;
+	std::unique_ptr<impl> pimpl;
+
+	struct Route;
+
+	void runRoute(Route& route);
+};
+
+#endif /* SRC_NMEARELAY_H_ */
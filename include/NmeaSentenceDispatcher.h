@@ -0,0 +1,266 @@
+/**
+*	@file NmeaSentenceDispatcher.h
+*	@brief Header file for NmeaSentenceDispatcher class
+*/
+
+#ifndef SRC_NMEASENTENCEDISPATCHER_H_
+#define SRC_NMEASENTENCEDISPATCHER_H_
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "NmeaMulticastUdpListener.h"
+
+/**
+ * @brief Integer key of a three letter sentence formatter, e.g. nmeaFormatterKey("HDT").
+ */
+constexpr uint32_t nmeaFormatterKey(const char* formatter) {
+	return (uint32_t(uint8_t(formatter[0])) << 16)
+			| (uint32_t(uint8_t(formatter[1])) << 8) | uint8_t(formatter[2]);
+}
+
+/**
+ * @brief Declare a formatter tag type usable with NmeaSentenceDispatcher.
+ */
+#define NMEA_FORMATTER(name) \
+	struct name { \
+		static_assert(sizeof(#name) == 4, "Sentence formatters have three characters"); \
+		static constexpr uint32_t key = nmeaFormatterKey(#name); \
+	}
+
+/**
+ * @brief Tag types of common sentence formatters. Declare others with NMEA_FORMATTER.
+ */
+namespace NmeaFormatter {
+NMEA_FORMATTER(ALR);
+NMEA_FORMATTER(DBT);
+NMEA_FORMATTER(DPT);
+NMEA_FORMATTER(GGA);
+NMEA_FORMATTER(GLL);
+NMEA_FORMATTER(GSA);
+NMEA_FORMATTER(GSV);
+NMEA_FORMATTER(HDG);
+NMEA_FORMATTER(HDT);
+NMEA_FORMATTER(MTW);
+NMEA_FORMATTER(MWV);
+NMEA_FORMATTER(RMC);
+NMEA_FORMATTER(ROT);
+NMEA_FORMATTER(RSA);
+NMEA_FORMATTER(THS);
+NMEA_FORMATTER(TLL);
+NMEA_FORMATTER(TTM);
+NMEA_FORMATTER(VBW);
+NMEA_FORMATTER(VDM);
+NMEA_FORMATTER(VDO);
+NMEA_FORMATTER(VHW);
+NMEA_FORMATTER(VTG);
+NMEA_FORMATTER(XDR);
+NMEA_FORMATTER(ZDA);
+}
+
+/*
+ * Compile time search of a multiplicative perfect hash: slot = (key * multiplier) >> (32 - bits).
+ */
+namespace NmeaDispatchDetail {
+
+const unsigned maxAttempts = 400;
+
+constexpr uint32_t slot(uint32_t key, uint32_t multiplier, unsigned bits) {
+	return static_cast<uint32_t>(key * multiplier) >> (32 - bits);
+}
+
+constexpr uint32_t candidate(unsigned attempt) {
+	return 2654435761u + 2 * 40503u * attempt;
+}
+
+constexpr bool differs(uint32_t, unsigned, uint32_t) {
+	return true;
+}
+
+template<typename ... Rest>
+constexpr bool differs(uint32_t multiplier, unsigned bits, uint32_t key,
+		uint32_t first, Rest ... rest) {
+	return slot(key, multiplier, bits) != slot(first, multiplier, bits)
+			&& differs(multiplier, bits, key, rest...);
+}
+
+constexpr bool unique(uint32_t, unsigned) {
+	return true;
+}
+
+template<typename ... Rest>
+constexpr bool unique(uint32_t multiplier, unsigned bits, uint32_t first,
+		Rest ... rest) {
+	return differs(multiplier, bits, first, rest...)
+			&& unique(multiplier, bits, rest...);
+}
+
+template<typename ... Keys>
+constexpr uint32_t findMultiplier(unsigned attempt, unsigned bits,
+		Keys ... keys) {
+	return (attempt > maxAttempts) ? 0 :
+			unique(candidate(attempt), bits, keys...) ?
+					candidate(attempt) :
+					findMultiplier(attempt + 1, bits, keys...);
+}
+
+// Smallest table of at least four slots per key, collisions are then rare and the search short.
+constexpr unsigned tableBits(std::size_t count, unsigned bits = 1) {
+	return ((std::size_t(1) << bits) >= 4 * count) ? bits :
+			tableBits(count, bits + 1);
+}
+
+template<typename F, typename ... List>
+struct IndexOf;
+
+template<typename F, typename ... List>
+struct IndexOf<F, F, List...> {
+	static const std::size_t value = 0;
+};
+
+template<typename F, typename Other, typename ... List>
+struct IndexOf<F, Other, List...> {
+	static const std::size_t value = 1 + IndexOf<F, List...>::value;
+};
+
+template<typename F>
+struct IndexOf<F> {
+	static_assert(sizeof(F) == 0, "Formatter not declared in the NmeaSentenceDispatcher");
+	static const std::size_t value = 0;
+};
+
+}
+
+/**
+ * @brief Listener that routes each sentence to a handler registered for its formatter.
+ *
+ * The set of formatters is fixed at compile time, the formatter codes become integer keys and a perfect
+ * hash over them is searched by the compiler. Dispatching a sentence costs one multiplication, one table
+ * load, one key compare and the handler call, whatever the number of formatters.
+ *
+ * Usage:
+ * @code
+ * using namespace NmeaFormatter;
+ * auto dispatcher = std::make_shared<NmeaSentenceDispatcher<HDT, THS, ROT, GGA>>();
+ * dispatcher->on<HDT>([](const std::string& sourceId, const std::string& nmea) { ... });
+ * dispatcher->on<GGA>(...);
+ * dispatcher->otherwise(...);
+ * multicast.setListener(dispatcher);
+ * @endcode
+ *
+ * Handlers are called from the thread calling the listener. Register them before listening starts.
+ * Timeout and error events are ignored, override them in a derived class if needed.
+ */
+template<typename ... Formatters>
+class NmeaSentenceDispatcher: public NmeaMulticastUdpListener {
+public:
+	/**
+	 * @brief Handler signature, same arguments as NmeaMulticastUdpListener::onStringAvailable.
+	 */
+	typedef std::function<void(const std::string& sourceId, const std::string& nmea)> Handler;
+
+	/**
+	 * @brief Number of formatters.
+	 */
+	static const std::size_t FormatterCount = sizeof...(Formatters);
+
+	static_assert(FormatterCount > 0, "At least one formatter is needed");
+
+	/**
+	 * @brief Constructor
+	 */
+	NmeaSentenceDispatcher() {
+		for (auto& entry : table) {
+			entry.key = 0;
+			entry.index = FormatterCount;
+		}
+		const uint32_t keys[] = { Formatters::key... };
+		for (std::size_t i = 0; i < FormatterCount; ++i) {
+			Entry& entry = table[NmeaDispatchDetail::slot(keys[i], Multiplier,
+					Bits)];
+			entry.key = keys[i];
+			entry.index = i;
+		}
+	}
+
+	/**
+	 * @brief Register the handler of a formatter.
+	 *
+	 * @param [in] handler Called for every sentence with formatter F. Replaces any previous handler.
+	 */
+	template<typename F>
+	void on(Handler handler) {
+		handlers[NmeaDispatchDetail::IndexOf<F, Formatters...>::value] =
+				std::move(handler);
+	}
+
+	/**
+	 * @brief Register the handler of sentences without a handler of their own.
+	 *
+	 * @param [in] handler Called for sentences whose formatter is not in the set or has no handler.
+	 */
+	void otherwise(Handler handler) {
+		fallback = std::move(handler);
+	}
+
+	/**
+	 * @brief Route a sentence to its handler.
+	 *
+	 * @param [in] sourceId Source Id of the sentence.
+	 * @param [in] nmea NMEA sentence, e.g. "$GPHDT,123.4,T*00".
+	 *
+	 * @return True if a handler was called.
+	 */
+	bool dispatch(const std::string& sourceId, const std::string& nmea) {
+		// Formatter follows the start character and the two character talker.
+		if (nmea.size() >= 6) {
+			uint32_t key = nmeaFormatterKey(&nmea[3]);
+			const Entry& entry = table[NmeaDispatchDetail::slot(key, Multiplier,
+					Bits)];
+			if (entry.key == key && handlers[entry.index]) {
+				handlers[entry.index](sourceId, nmea);
+				return true;
+			}
+		}
+		if (fallback) {
+			fallback(sourceId, nmea);
+			return true;
+		}
+		return false;
+	}
+
+	virtual void onStringAvailable(const std::string& sourceId,
+			const std::string& nmea) {
+		dispatch(sourceId, nmea);
+	}
+
+	virtual void onTimeout() {
+	}
+
+	virtual void onConnectionError() {
+	}
+
+	virtual void onChecksumError() {
+	}
+
+private:
+	static const unsigned Bits = NmeaDispatchDetail::tableBits(FormatterCount);
+	static const uint32_t Multiplier = NmeaDispatchDetail::findMultiplier(0,
+			Bits, Formatters::key...);
+
+	static_assert(Multiplier != 0, "No perfect hash found, formatters must be distinct");
+
+	struct Entry {
+		uint32_t key;
+		std::size_t index;
+	};
+
+	std::array<Entry, std::size_t(1) << Bits> table;
+	// One spare handler, always empty, for table slots without a formatter.
+	std::array<Handler, FormatterCount + 1> handlers;
+	Handler fallback;
+};
+
+#endif /* SRC_NMEASENTENCEDISPATCHER_H_ */
@@ -0,0 +1,91 @@
+/**
+*	@file NmeaSentenceEncoder.h
+*	@brief Header file for the typed NMEA sentence encoders
+*/
+
+#ifndef SRC_NMEASENTENCEENCODER_H_
+#define SRC_NMEASENTENCEENCODER_H_
+
+#include <cstddef>
+
+/**
+ * @brief Minimum buffer capacity accepted by the nmeaEncode() functions.
+ *
+ * Every field has a bounded width, so no encoded sentence is longer than this.
+ */
+const std::size_t NmeaEncodedSentenceMaxSize = 128;
+
+/**
+ * @brief Contents of a HDT sentence, heading true.
+ */
+struct NmeaTrueHeading {
+	double heading;		///< Degrees true, written with two decimals in [0, 360).
+};
+
+/**
+ * @brief Contents of a THS sentence, true heading and status.
+ */
+struct NmeaTrueHeadingStatus {
+	double heading;		///< Degrees true, written with two decimals in [0, 360).
+	char mode;			///< 'A' autonomous, 'E' estimated, 'M' manual input, 'S' simulator, 'V' data not valid. Any other value is rejected.
+};
+
+/**
+ * @brief Contents of a ROT sentence, rate of turn.
+ */
+struct NmeaRateOfTurn {
+	double rate;		///< Degrees per minute with one decimal, negative when the bow turns to port. Below 10000 in magnitude.
+	bool valid;			///< Status field, 'A' if true, 'V' if false. Written as 'V' when the rate is NaN or out of range.
+};
+
+/**
+ * @brief Contents of a GGA sentence, global positioning system fix data.
+ */
+struct NmeaPosition {
+	double time;			///< UTC seconds since midnight, written as hhmmss.ss.
+	double latitude;		///< Degrees, positive north. Written as ddmm.mmmmm.
+	double longitude;		///< Degrees, positive east. Written as dddmm.mmmmm.
+	unsigned quality;		///< GPS quality indicator, 0 to 8.
+	unsigned satellites;	///< Number of satellites in use, 0 to 99.
+	double hdop;			///< Horizontal dilution of precision.
+	double altitude;		///< Antenna altitude above mean sea level, metres.
+	double geoidSeparation;	///< Geoidal separation, metres.
+	double dgpsAge;			///< Age of the differential data in seconds. Negative for a null field.
+	int dgpsStation;		///< Differential reference station Id, 0 to 1023. Negative for a null field.
+};
+
+/**
+ * @name Typed sentence encoders
+ *
+ * Each function writes one complete sentence, from the '$' to the checksum and without line terminator, e.g.
+ * "$HEHDT,123.45,T*hh". Numbers are formatted by hand with a fixed number of decimals, no locale and no
+ * stdio are involved, and the checksum is accumulated while the characters are written.
+ *
+ * A NaN value, or a value too wide for its field, is written as a null field. A ROT sentence with a null rate
+ * is marked not valid.
+ *
+ * NmeaDatagramWriter::encodeSentence() and NmeaMulticastUdp::sendSentence() call them to place the sentence
+ * straight after the TAG block of the outgoing datagram.
+ *
+ * @param [out] buffer Destination buffer.
+ * @param [in] capacity Size of the destination buffer, at least NmeaEncodedSentenceMaxSize.
+ * @param [in] talker Two character talker identifier, e.g. "HE".
+ * @param [in] sentence Sentence contents.
+ *
+ * @return Number of characters written, 0 if the buffer is too small or the THS mode is not one of "AEMSV".
+ * @{
+ */
+std::size_t nmeaEncode(char* buffer, std::size_t capacity, const char* talker,
+		const NmeaTrueHeading& sentence);
+
+std::size_t nmeaEncode(char* buffer, std::size_t capacity, const char* talker,
+		const NmeaTrueHeadingStatus& sentence);
+
+std::size_t nmeaEncode(char* buffer, std::size_t capacity, const char* talker,
+		const NmeaRateOfTurn& sentence);
+
+std::size_t nmeaEncode(char* buffer, std::size_t capacity, const char* talker,
+		const NmeaPosition& sentence);
+/** @} */
+
+#endif /* SRC_NMEASENTENCEENCODER_H_ */
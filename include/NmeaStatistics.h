@@ -0,0 +1,279 @@
+/**
+*	@file NmeaStatistics.h
+*	@brief Header file for NmeaStatistics and NmeaStatisticsReader classes
+*/
+
+#ifndef SRC_NMEASTATISTICS_H_
+#define SRC_NMEASTATISTICS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+
+#include "NmeaMulticastUdp.h"
+
+/**
+ * @brief Default name of the shared memory segment.
+ */
+const char* const NmeaStatisticsDefaultName = "/NmeaMulticast";
+
+/**
+ * @brief Number of transmission groups in the segment, one per NmeaTrasmissionGroupEnum value.
+ */
+const std::size_t NmeaStatisticsGroupCount = NmeaTransmissionGroup_USR8 + 1;
+
+/**
+ * @brief Maximum number of source Ids tracked per transmission group.
+ */
+const std::size_t NmeaStatisticsMaxSources = 32;
+
+/**
+ * @brief Maximum length of a tracked source Id, longer Ids are truncated.
+ */
+const std::size_t NmeaStatisticsSourceIdSize = 16;
+
+/**
+ * @brief Number of listener latency buckets.
+ *
+ * Bucket 0 counts deliveries under 1 us, bucket i counts deliveries from 2^(i-1) us up to 2^i us, the last
+ * bucket counts everything slower.
+ */
+const std::size_t NmeaStatisticsLatencyBuckets = 16;
+
+/**
+ * @brief Counters of one source Id. Filled by NmeaStatisticsReader::snapshot().
+ */
+struct NmeaSourceStatistics {
+	char sourceId[NmeaStatisticsSourceIdSize + 1];	///< Null terminated source Id.
+	uint64_t sentences;								///< Sentences received.
+	uint64_t bytes;									///< Sentence bytes received.
+};
+
+/**
+ * @brief Counters of one transmission group. Filled by NmeaStatisticsReader::snapshot().
+ *
+ * All counters are totals since the publisher opened the segment, rates are computed by the reader from
+ * two snapshots.
+ */
+struct NmeaGroupStatistics {
+	uint64_t datagrams;			///< Datagrams received.
+	uint64_t bytes;				///< Datagram bytes received.
+	uint64_t sentences;			///< Sentences received.
+	uint64_t parseErrors;		///< Datagrams without the "UdPbC" header or without sentences.
+	uint64_t drops;				///< Sentences or datagrams dropped by the library: conflation, group assembly, buffer pool.
+	uint64_t kernelDrops;		///< Datagrams dropped by the kernel because the socket buffer was full.
+	uint64_t sourceOverflows;	///< Sentences from source Ids beyond NmeaStatisticsMaxSources.
+	uint64_t deliveries;		///< Listener calls timed.
+	uint64_t latency[NmeaStatisticsLatencyBuckets];	///< Listener processing time histogram.
+	std::size_t sourceCount;	///< Entries used in sources.
+	NmeaSourceStatistics sources[NmeaStatisticsMaxSources];	///< Per source counters.
+};
+
+struct NmeaStatisticsSegment;
+
+/**
+ * @brief Publishes receive statistics into a named POSIX shared memory segment.
+ *
+ * The segment holds one block per transmission group. Each block has two sections, one written by the
+ * receiving thread and one by the thread calling the listener, each protected by a sequence lock: writers
+ * never wait, take no locks and make no system calls, readers in other processes retry when they overlap
+ * with a write.
+ *
+ * Usage: open the publisher and pass it to NmeaMulticastUdp::setStatistics(). Several NmeaMulticastUdp
+ * objects can share a publisher as long as each one listens to a different transmission group, which
+ * setStatistics() enforces through acquireGroup().
+ * Inspect the segment with NmeaStatisticsReader or the nmeatop tool.
+ */
+class NmeaStatistics {
+public:
+	/**
+	 * @brief Constructor
+	 *
+	 * @param [in] name Name of the shared memory segment, starting with '/'.
+	 */
+	explicit NmeaStatistics(const std::string& name = NmeaStatisticsDefaultName);
+
+	NmeaStatistics(const NmeaStatistics&) = delete;
+	NmeaStatistics& operator=(const NmeaStatistics&) = delete;
+
+	/**
+	 * @brief Destructor
+	 */
+	virtual ~NmeaStatistics();
+
+	/**
+	 * @brief Create the segment.
+	 *
+	 * A segment left behind by a publisher that is no longer running is replaced. A segment whose publisher
+	 * is still running, or whose publisher cannot be determined, is left alone and open() fails.
+	 *
+	 * @return True on success, false on failure or if already open.
+	 */
+	bool open();
+
+	/**
+	 * @brief Unmap and remove the segment.
+	 *
+	 * @return True on success, false if already closed.
+	 */
+	bool close();
+
+	/**
+	 * @brief Verify if the segment is open.
+	 */
+	bool isOpen();
+
+	/**
+	 * @brief Reserve the counters of a transmission group for one writer.
+	 *
+	 * The record functions are lock free because each block has a single writer. Called by
+	 * NmeaMulticastUdp::setStatistics().
+	 *
+	 * @param [in] group Transmission group.
+	 *
+	 * @return True on success, false if another writer holds the group.
+	 */
+	bool acquireGroup(NmeaTrasmissionGroupEnum group);
+
+	/**
+	 * @brief Release a transmission group reserved with acquireGroup().
+	 *
+	 * @param [in] group Transmission group.
+	 */
+	void releaseGroup(NmeaTrasmissionGroupEnum group);
+
+	/**
+	 * @brief Count a received datagram. Called from the receiving thread.
+	 *
+	 * @param [in] group Transmission group.
+	 * @param [in] bytes Datagram size.
+	 * @param [in] valid False if the datagram could not be parsed.
+	 */
+	void recordDatagram(NmeaTrasmissionGroupEnum group, std::size_t bytes,
+			bool valid);
+
+	/**
+	 * @brief Count a received sentence. Called from the receiving thread.
+	 *
+	 * @param [in] group Transmission group.
+	 * @param [in] sourceId Source Id of the sentence, not null terminated.
+	 * @param [in] sourceIdSize Source Id size.
+	 * @param [in] bytes Sentence size.
+	 */
+	void recordSentence(NmeaTrasmissionGroupEnum group, const char* sourceId,
+			std::size_t sourceIdSize, std::size_t bytes);
+
+	/**
+	 * @brief Count dropped sentences or datagrams. Called from the receiving thread.
+	 *
+	 * @param [in] group Transmission group.
+	 * @param [in] count Number of drops to add.
+	 */
+	void recordDrops(NmeaTrasmissionGroupEnum group, uint64_t count);
+
+	/**
+	 * @brief Publish the kernel drop counter of the socket. Called from the receiving thread.
+	 *
+	 * @param [in] group Transmission group.
+	 * @param [in] total Drops reported by the kernel since the socket was opened.
+	 */
+	void recordKernelDrops(NmeaTrasmissionGroupEnum group, uint64_t total);
+
+	/**
+	 * @brief Count a listener call. Called from the thread calling the listener.
+	 *
+	 * @param [in] group Transmission group.
+	 * @param [in] elapsed Time spent in the listener.
+	 */
+	void recordDelivery(NmeaTrasmissionGroupEnum group,
+			std::chrono::steady_clock::duration elapsed);
+
+private:
+	std::string name;
+	NmeaStatisticsSegment* segment;
+	std::atomic<bool> writers[NmeaStatisticsGroupCount];
+
+	bool removeStale();
+};
+
+/**
+ * @brief Reads a segment published by NmeaStatistics.
+ *
+ * Maps the segment read only, so attaching a reader has no effect on the publishing process.
+ */
+class NmeaStatisticsReader {
+public:
+	/**
+	 * @brief Constructor
+	 *
+	 * @param [in] name Name of the shared memory segment, starting with '/'.
+	 */
+	explicit NmeaStatisticsReader(const std::string& name = NmeaStatisticsDefaultName);
+
+	NmeaStatisticsReader(const NmeaStatisticsReader&) = delete;
+	NmeaStatisticsReader& operator=(const NmeaStatisticsReader&) = delete;
+
+	/**
+	 * @brief Destructor
+	 */
+	virtual ~NmeaStatisticsReader();
+
+	/**
+	 * @brief Attach to the segment.
+	 *
+	 * @return True on success. False if the segment does not exist, has an unknown layout or if already open.
+	 */
+	bool open();
+
+	/**
+	 * @brief Detach from the segment.
+	 *
+	 * @return True on success, false if already closed.
+	 */
+	bool close();
+
+	/**
+	 * @brief Verify if the reader is attached.
+	 */
+	bool isOpen();
+
+	/**
+	 * @brief Process Id of the publisher.
+	 */
+	int publisherPid() const;
+
+	/**
+	 * @brief Verify if the attached segment is still the published one.
+	 *
+	 * A publisher that restarts removes its old segment and creates a new one, the reader keeps seeing the
+	 * old counters frozen until it is closed and opened again.
+	 *
+	 * @return True if the name no longer refers to the attached segment, or if not attached.
+	 */
+	bool isReplaced() const;
+
+	/**
+	 * @brief Read the counters of a transmission group.
+	 *
+	 * Lock free. Each section is copied consistently, the receive and delivery sections may be from
+	 * slightly different instants.
+	 *
+	 * @param [in] group Transmission group.
+	 * @param [out] statistics Copy of the counters.
+	 *
+	 * @return True on success. False if not attached, or if the publisher kept writing the section during
+	 * every attempt or died in the middle of a write: the copy is then not consistent.
+	 */
+	bool snapshot(NmeaTrasmissionGroupEnum group,
+			NmeaGroupStatistics& statistics) const;
+
+private:
+	std::string name;
+	const NmeaStatisticsSegment* segment;
+	dev_t device;
+	ino_t inode;
+};
+
+#endif /* SRC_NMEASTATISTICS_H_ */
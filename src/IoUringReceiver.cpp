@@ -0,0 +1,349 @@
+/**
+ *	@file IoUringReceiver.cpp
+ *	@brief Implementation of the internal IoUringReceiver class
+ */
+
+#include "IoUringReceiver.h"
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include <boost/log/trivial.hpp>
+
+#ifdef NM_DEBUG
+#define LOG_MESSAGE(lvl) BOOST_LOG_TRIVIAL(lvl)
+#else
+#define LOG_MESSAGE(lvl) if (false) BOOST_LOG_TRIVIAL(lvl)
+#endif
+
+const unsigned sqEntries = 4;
+const uint16_t bufferGroup = 0;
+const uint64_t recvUserData = 1;
+const std::size_t bufferAlignment = 64;
+
+// io_uring_buf_ring is not used directly: its flexible array member gets a
+// non zero offset when compiled as C++. The ring is an array of io_uring_buf
+// with the tail overlaid on the resv field of the first entry.
+static io_uring_buf* bufRingEntry(void* ring, unsigned index) {
+	return static_cast<io_uring_buf*>(ring) + index;
+}
+
+static uint16_t* bufRingTail(void* ring) {
+	return &static_cast<io_uring_buf*>(ring)->resv;
+}
+
+static int ioUringSetup(unsigned entries, io_uring_params* p) {
+	return static_cast<int>(::syscall(__NR_io_uring_setup, entries, p));
+}
+
+static int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete,
+		unsigned flags, const void* arg, std::size_t argSize) {
+	return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit,
+			minComplete, flags, arg, argSize));
+}
+
+static int ioUringRegister(int fd, unsigned opcode, const void* arg,
+		unsigned nrArgs) {
+	return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg,
+			nrArgs));
+}
+
+IoUringReceiver::IoUringReceiver(std::size_t payloadSize, unsigned bufferCount) :
+		ringFd(-1), socketFd(-1), payloadSize(payloadSize), bufferSize(
+				(sizeof(io_uring_recvmsg_out) + payloadSize + bufferAlignment - 1)
+						& ~(bufferAlignment - 1)), bufferCount(
+				bufferCount), sqRing(MAP_FAILED), sqRingSize(0), cqRing(
+				MAP_FAILED), cqRingSize(0), sqes(MAP_FAILED), sqesSize(0), sqHead(
+				nullptr), sqTail(nullptr), sqMask(0), sqArray(nullptr), cqHead(
+				nullptr), cqTail(nullptr), cqMask(0), cqes(nullptr), bufRing(
+				MAP_FAILED), bufRingSize(0), buffers(nullptr), bufTail(0), armed(
+				false), received(false), heldBuffer(-1), truncated(0), exhausted(0) {
+	memset(&msg, 0, sizeof(msg));
+}
+
+IoUringReceiver::~IoUringReceiver() {
+	close();
+}
+
+bool IoUringReceiver::open(int fd) {
+	if (isOpen()) {
+		return false;
+	}
+
+	io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	params.flags = IORING_SETUP_CQSIZE;
+	params.cq_entries = bufferCount;
+
+	ringFd = ioUringSetup(sqEntries, &params);
+	if (ringFd < 0) {
+		LOG_MESSAGE(debug)<< "io_uring_setup no disponible '" << strerror(errno) << "'";
+		ringFd = -1;
+		return false;
+	}
+
+	if (!(params.features & IORING_FEAT_SINGLE_MMAP)
+			|| !(params.features & IORING_FEAT_EXT_ARG)) {
+		LOG_MESSAGE(debug)<< "io_uring sin soporte de SINGLE_MMAP o EXT_ARG";
+		close();
+		return false;
+	}
+
+	sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	if (cqRingSize > sqRingSize) {
+		sqRingSize = cqRingSize;
+	}
+	cqRingSize = sqRingSize;
+
+	sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE,
+	MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+	if (sqRing == MAP_FAILED) {
+		close();
+		return false;
+	}
+	// Single mmap, completion ring shares the submission ring mapping.
+	cqRing = sqRing;
+
+	sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+	sqes = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE,
+	MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+	if (sqes == MAP_FAILED) {
+		close();
+		return false;
+	}
+
+	char* sq = static_cast<char*>(sqRing);
+	sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+	sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+	sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+	sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+	char* cq = static_cast<char*>(cqRing);
+	cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+	cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+	cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+	cqes = cq + params.cq_off.cqes;
+
+	// Provided buffer ring, must be page aligned. Not populated, small datagrams only touch the first page of
+	// their buffer.
+	bufRingSize = bufferCount * sizeof(io_uring_buf) + bufferCount * bufferSize;
+	bufRing = mmap(nullptr, bufRingSize, PROT_READ | PROT_WRITE,
+	MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (bufRing == MAP_FAILED) {
+		close();
+		return false;
+	}
+	buffers = static_cast<char*>(bufRing) + bufferCount * sizeof(io_uring_buf);
+
+	io_uring_buf_reg reg;
+	memset(&reg, 0, sizeof(reg));
+	reg.ring_addr = reinterpret_cast<uint64_t>(bufRing);
+	reg.ring_entries = bufferCount;
+	reg.bgid = bufferGroup;
+	if (ioUringRegister(ringFd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+		LOG_MESSAGE(debug)<< "io_uring sin soporte de PBUF_RING '" << strerror(errno) << "'";
+		close();
+		return false;
+	}
+
+	bufTail = 0;
+	for (unsigned bid = 0; bid < bufferCount; ++bid) {
+		io_uring_buf* buf = bufRingEntry(bufRing, bufTail & (bufferCount - 1));
+		buf->addr = reinterpret_cast<uint64_t>(buffers + bid * bufferSize);
+		buf->len = bufferSize;
+		buf->bid = bid;
+		++bufTail;
+	}
+	__atomic_store_n(bufRingTail(bufRing), bufTail, __ATOMIC_RELEASE);
+
+	socketFd = fd;
+	armed = false;
+	received = false;
+	heldBuffer = -1;
+	truncated = 0;
+	exhausted = 0;
+
+	LOG_MESSAGE(debug)<< "IoUringReceiver abierto con " << bufferCount << " buffers de " << bufferSize << "b";
+
+	return true;
+}
+
+void IoUringReceiver::close() {
+	// Closing the ring cancels the pending multishot request.
+	if (ringFd >= 0) {
+		::close(ringFd);
+		ringFd = -1;
+	}
+	if (bufRing != MAP_FAILED) {
+		munmap(bufRing, bufRingSize);
+		bufRing = MAP_FAILED;
+		buffers = nullptr;
+	}
+	if (sqes != MAP_FAILED) {
+		munmap(sqes, sqesSize);
+		sqes = MAP_FAILED;
+	}
+	if (sqRing != MAP_FAILED) {
+		munmap(sqRing, sqRingSize);
+		sqRing = MAP_FAILED;
+		cqRing = MAP_FAILED;
+	}
+	socketFd = -1;
+	armed = false;
+	heldBuffer = -1;
+}
+
+bool IoUringReceiver::isOpen() const {
+	return (ringFd >= 0);
+}
+
+bool IoUringReceiver::arm() {
+	unsigned tail = *sqTail;
+	unsigned index = tail & sqMask;
+	io_uring_sqe* sqe = &static_cast<io_uring_sqe*>(sqes)[index];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_RECVMSG;
+	sqe->fd = socketFd;
+	sqe->addr = reinterpret_cast<uint64_t>(&msg);
+	sqe->len = 1;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = bufferGroup;
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->user_data = recvUserData;
+	sqArray[index] = index;
+	__atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+
+	if (ioUringEnter(ringFd, 1, 0, 0, nullptr, 0) != 1) {
+		LOG_MESSAGE(error)<< "io_uring_enter no pudo enviar recvmsg '" << strerror(errno) << "'";
+		return false;
+	}
+	armed = true;
+	return true;
+}
+
+void IoUringReceiver::recycle(int bid) {
+	io_uring_buf* buf = bufRingEntry(bufRing, bufTail & (bufferCount - 1));
+	buf->addr = reinterpret_cast<uint64_t>(buffers + bid * bufferSize);
+	buf->len = bufferSize;
+	buf->bid = bid;
+	++bufTail;
+	__atomic_store_n(bufRingTail(bufRing), bufTail, __ATOMIC_RELEASE);
+}
+
+int IoUringReceiver::receive(const char*& data, const timeval& timeout) {
+	if (heldBuffer >= 0) {
+		recycle(heldBuffer);
+		heldBuffer = -1;
+	}
+
+	auto deadline = std::chrono::steady_clock::now()
+			+ std::chrono::seconds(timeout.tv_sec)
+			+ std::chrono::microseconds(timeout.tv_usec);
+
+	while (true) {
+		if (!armed && !arm()) {
+			return -1;
+		}
+
+		unsigned head = *cqHead;
+		if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+			auto remaining = std::chrono::duration_cast<
+					std::chrono::microseconds>(
+					deadline - std::chrono::steady_clock::now());
+			if (remaining.count() <= 0) {
+				return -2;
+			}
+			timeval left;
+			left.tv_sec = remaining.count() / 1000000;
+			left.tv_usec = remaining.count() % 1000000;
+			int ret = wait(left);
+			if (ret < 0) {
+				return ret;
+			}
+			if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+				return -2;
+			}
+		}
+
+		io_uring_cqe cqe = static_cast<io_uring_cqe*>(cqes)[head & cqMask];
+		__atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+
+		if (!(cqe.flags & IORING_CQE_F_MORE)) {
+			// Multishot request terminated, armed again on next iteration.
+			armed = false;
+		}
+
+		if (cqe.res < 0) {
+			if (!received && (cqe.res == -EINVAL || cqe.res == -EOPNOTSUPP)) {
+				return Unsupported;
+			}
+			if (cqe.res == -ENOBUFS) {
+				// Every buffer was in use, the datagrams wait in the socket queue until armed again.
+				++exhausted;
+				LOG_MESSAGE(debug)<< "io_uring sin buffers libres, se rearma recvmsg";
+				continue;
+			}
+			return -1;
+		}
+
+		if (!(cqe.flags & IORING_CQE_F_BUFFER)) {
+			return -1;
+		}
+
+		int bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+		received = true;
+
+		const char* buffer = buffers + bid * bufferSize;
+		const io_uring_recvmsg_out* out =
+				reinterpret_cast<const io_uring_recvmsg_out*>(buffer);
+		const char* payload = buffer + sizeof(io_uring_recvmsg_out)
+				+ msg.msg_namelen + msg.msg_controllen;
+		// The alignment slack must not let through datagrams larger than requested.
+		std::size_t room = std::min(payloadSize,
+				bufferSize - (payload - buffer));
+
+		if ((out->flags & MSG_TRUNC) || out->payloadlen > room) {
+			++truncated;
+			LOG_MESSAGE(error)<< "Datagrama de " << out->payloadlen << "b descartado, buffer de " << room << "b";
+			recycle(bid);
+			continue;
+		}
+
+		heldBuffer = bid;
+		data = payload;
+		return out->payloadlen;
+	}
+}
+
+int IoUringReceiver::wait(const timeval& timeout) {
+	__kernel_timespec ts;
+	ts.tv_sec = timeout.tv_sec;
+	ts.tv_nsec = timeout.tv_usec * 1000;
+
+	io_uring_getevents_arg arg;
+	memset(&arg, 0, sizeof(arg));
+	arg.ts = reinterpret_cast<uint64_t>(&ts);
+
+	int ret = ioUringEnter(ringFd, 0, 1,
+	IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+	if (ret < 0 && errno != ETIME && errno != EINTR) {
+		return -1;
+	}
+	return 0;
+}
+
+uint64_t IoUringReceiver::truncatedCount() const {
+	return truncated;
+}
+
+uint64_t IoUringReceiver::exhaustedCount() const {
+	return exhausted;
+}
@@ -0,0 +1,133 @@
+/**
+*	@file IoUringReceiver.h
+*	@brief Header for the internal IoUringReceiver class
+*/
+
+#ifndef SRC_IOURINGRECEIVER_H_
+#define SRC_IOURINGRECEIVER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+/**
+ * @brief io_uring datagram receiver used by MulticastUdp.
+ *
+ * Keeps a multishot recvmsg request armed on a socket. Datagrams are written by the kernel straight into a ring
+ * of provided buffers owned by this class, receive() hands out a pointer to the payload and the buffer is given
+ * back to the kernel on the next call.
+ *
+ * Talks to the kernel with raw system calls, no liburing needed. Requires Linux 6.0 or newer, open() fails
+ * on older kernels or when io_uring is disabled so the caller can fall back to recvfrom().
+ */
+class IoUringReceiver {
+public:
+	/**
+	 * @brief Return code of receive() when the kernel rejects multishot recvmsg.
+	 */
+	static const int Unsupported = -3;
+
+	/**
+	 * @brief Constructor
+	 *
+	 * Each provided buffer holds the recvmsg header followed by up to payloadSize bytes. Datagrams larger than
+	 * payloadSize are dropped and counted, never returned truncated.
+	 *
+	 * @param [in] payloadSize Largest datagram accepted.
+	 * @param [in] bufferCount Number of provided buffers. Must be a power of two.
+	 */
+	IoUringReceiver(std::size_t payloadSize, unsigned bufferCount);
+
+	/**
+	 * @brief Destructor
+	 */
+	~IoUringReceiver();
+
+	/**
+	 * @brief Create the ring and register the provided buffers.
+	 *
+	 * @param [in] fd Socket to receive from.
+	 *
+	 * @return True on success, false if io_uring is not available.
+	 */
+	bool open(int fd);
+
+	/**
+	 * @brief Release the ring and the buffers.
+	 */
+	void close();
+
+	/**
+	 * @brief Verify if the ring is open.
+	 */
+	bool isOpen() const;
+
+	/**
+	 * @brief Receive the next datagram.
+	 *
+	 * Waits again, within the same timeout, when every provided buffer was in use or the datagram was too large.
+	 *
+	 * @param [out] data Pointer to the payload. Valid until the next call to receive() or close().
+	 * @param [in] timeout Maximum time to wait.
+	 *
+	 * @return Number of bytes received. On error, -1. On timeout, -2. Unsupported if multishot recvmsg is not
+	 * available.
+	 */
+	int receive(const char*& data, const timeval& timeout);
+
+	/**
+	 * @brief Number of datagrams dropped because they were larger than the payload size.
+	 */
+	uint64_t truncatedCount() const;
+
+	/**
+	 * @brief Number of times the multishot request stopped because every provided buffer was in use.
+	 *
+	 * The datagrams stay in the socket queue and are received once the request is armed again.
+	 */
+	uint64_t exhaustedCount() const;
+
+private:
+	int ringFd;
+	int socketFd;
+
+	std::size_t payloadSize;
+	std::size_t bufferSize;
+	unsigned bufferCount;
+
+	void* sqRing;
+	std::size_t sqRingSize;
+	void* cqRing;
+	std::size_t cqRingSize;
+	void* sqes;
+	std::size_t sqesSize;
+
+	unsigned* sqHead;
+	unsigned* sqTail;
+	unsigned sqMask;
+	unsigned* sqArray;
+	unsigned* cqHead;
+	unsigned* cqTail;
+	unsigned cqMask;
+	void* cqes;
+
+	void* bufRing;
+	std::size_t bufRingSize;
+	char* buffers;
+	uint16_t bufTail;
+
+	msghdr msg;
+	bool armed;
+	bool received;
+	int heldBuffer;
+
+	uint64_t truncated;
+	uint64_t exhausted;
+
+	bool arm();
+	void recycle(int bid);
+	int wait(const timeval& timeout);
+};
+
+#endif /* SRC_IOURINGRECEIVER_H_ */
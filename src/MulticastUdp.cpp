@@ -6,10 +6,16 @@
 #include "MulticastUdp.h"
 #include "MulticastUdpListener.h"
 
+#include "IoUringReceiver.h"
+
+#include <atomic>
+
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <sys/types.h>
+#include <linux/filter.h>
+#include <linux/sock_diag.h>
 
 #include <boost/thread.hpp>
 #include <boost/log/trivial.hpp>
@@ -25,16 +31,25 @@ using namespace boost;
 const std::string DEFAULT_ADDRESS = "0.0.0.0";
 const std::string MULTICAST_MASK = "224.0.0.0";
 const int MAX_BUFFER_SIZE = 32768;
+const unsigned IOURING_BUFFER_COUNT = 64;
 
 class MulticastUdp::impl {
 public:
 	int fd;
-	bool active;
+	std::atomic<bool> active;
 
 	sockaddr_in interface;
 	sockaddr_in multicast;
 	timeval timeout;
 
+	MulticastUdpReceiveBackendEnum requestedBackend;
+	MulticastUdpReceiveBackendEnum backend;
+	std::unique_ptr<IoUringReceiver> ioUring;
+	std::atomic<uint64_t> truncated;
+
+	std::vector<in_addr> sources;
+	std::vector<MulticastUdpFilterInstruction> socketFilter;
+
 	thread listenerThread;
 	std::shared_ptr<MulticastUdpListener> listener;
 
@@ -42,9 +57,17 @@ public:
 };
 
 MulticastUdp::MulticastUdp(const MulticastUdp& obj) :
-		pimpl { new impl { -1, false, obj.pimpl->interface,
-				obj.pimpl->multicast, obj.pimpl->timeout } } {
-
+		pimpl { new impl } {
+	pimpl->fd = -1;
+	pimpl->active = false;
+	pimpl->truncated = 0;
+	pimpl->interface = obj.pimpl->interface;
+	pimpl->multicast = obj.pimpl->multicast;
+	pimpl->timeout = obj.pimpl->timeout;
+	pimpl->requestedBackend = obj.pimpl->requestedBackend;
+	pimpl->backend = obj.pimpl->requestedBackend;
+	pimpl->sources = obj.pimpl->sources;
+	pimpl->socketFilter = obj.pimpl->socketFilter;
 }
 
 MulticastUdp::MulticastUdp(const std::string& interfaceAddress,
@@ -53,6 +76,9 @@ MulticastUdp::MulticastUdp(const std::string& interfaceAddress,
 
 	pimpl->fd = -1;
 	pimpl->active = false;
+	pimpl->truncated = 0;
+	pimpl->requestedBackend = MulticastUdpReceiveBackend_Select;
+	pimpl->backend = MulticastUdpReceiveBackend_Select;
 
 	pimpl->interface.sin_family = AF_INET;
 	pimpl->interface.sin_port = htons(multicastPort);
@@ -101,6 +127,7 @@ bool MulticastUdp::open() {
 		int socket_temp = socket(AF_INET, SOCK_DGRAM, 0);
 		if (socket_temp >= 0) {
 			pimpl->fd = socket_temp;
+			pimpl->truncated = 0;
 			int yes = 1;
 
 			if (setsockopt(pimpl->fd, SOL_SOCKET, SO_REUSEADDR, &yes,
@@ -116,15 +143,34 @@ bool MulticastUdp::open() {
 
 			if (bindret == 0) {
 
-				struct ip_mreqn group;
-				group.imr_address = pimpl->interface.sin_addr;
-				group.imr_multiaddr = pimpl->multicast.sin_addr;
-				group.imr_ifindex = 0;
+				if (pimpl->sources.empty()) {
+					struct ip_mreqn group;
+					group.imr_address = pimpl->interface.sin_addr;
+					group.imr_multiaddr = pimpl->multicast.sin_addr;
+					group.imr_ifindex = 0;
+
+					LOG_MESSAGE(debug)<< "Configurando IP_ADD_MEMBERSHIP";
+					if (setsockopt(pimpl->fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &group,
+							sizeof(group)) != 0) {
+						LOG_MESSAGE(error)<< "No se pudo suscribir a la direccion multicast";
+					}
+				}
+
+				for (const auto& source : pimpl->sources) {
+					struct ip_mreq_source group;
+					group.imr_multiaddr = pimpl->multicast.sin_addr;
+					group.imr_interface = pimpl->interface.sin_addr;
+					group.imr_sourceaddr = source;
+
+					LOG_MESSAGE(debug)<< "Configurando IP_ADD_SOURCE_MEMBERSHIP " << inet_ntoa(source);
+					if (setsockopt(pimpl->fd, IPPROTO_IP, IP_ADD_SOURCE_MEMBERSHIP,
+							&group, sizeof(group)) != 0) {
+						LOG_MESSAGE(error)<< "No se pudo suscribir a la fuente " << inet_ntoa(source);
+					}
+				}
 
-				LOG_MESSAGE(debug)<< "Configurando IP_ADD_MEMBERSHIP";
-				if (setsockopt(pimpl->fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &group,
-						sizeof(group)) != 0) {
-					LOG_MESSAGE(error)<< "No se pudo suscribir a la direccion multicast";
+				if (!pimpl->socketFilter.empty() && !attachSocketFilter()) {
+					LOG_MESSAGE(error)<< "No se pudo instalar el filtro del socket";
 				}
 
 				LOG_MESSAGE(debug)<< "Habilita IP_MULTICAST_LOOP";
@@ -154,6 +200,21 @@ bool MulticastUdp::open() {
 
 				LOG_MESSAGE(debug)<< "UdpSocket::open rcvbuffer = " << rcvbuffer << "b sndbuffer = " << sndbuffer << "b";
 
+				pimpl->backend = MulticastUdpReceiveBackend_Select;
+				if (pimpl->requestedBackend
+						== MulticastUdpReceiveBackend_IoUring) {
+					if (!pimpl->ioUring) {
+						pimpl->ioUring.reset(
+								new IoUringReceiver(MAX_BUFFER_SIZE,
+										IOURING_BUFFER_COUNT));
+					}
+					if (pimpl->ioUring->open(pimpl->fd)) {
+						pimpl->backend = MulticastUdpReceiveBackend_IoUring;
+					} else {
+						LOG_MESSAGE(info)<< "io_uring no disponible, se usa select";
+					}
+				}
+
 				ret = true;
 			} else {
 				LOG_MESSAGE(error)<< "Error al hacer bind '" << strerror(errno) << "'";
@@ -183,6 +244,9 @@ bool MulticastUdp::close() {
 		if (pimpl->active) {
 			stopListening();
 		}
+		if (pimpl->ioUring) {
+			pimpl->ioUring->close();
+		}
 		::close(pimpl->fd);
 		pimpl->fd = -1;
 		ret = true;
@@ -202,21 +266,133 @@ int MulticastUdp::send(const void* buffer, std::size_t size) {
 }
 
 int MulticastUdp::recv(void* buffer, std::size_t size) {
-	static fd_set readset;
-	FD_ZERO(&readset);
-	FD_SET(pimpl->fd, &readset);
+	if (pimpl->backend == MulticastUdpReceiveBackend_IoUring) {
+		for (;;) {
+			const char* data;
+			int ret = receive(data);
+			if (ret > 0 && static_cast<std::size_t>(ret) > size) {
+				++pimpl->truncated;
+				continue;
+			}
+			if (ret > 0) {
+				memcpy(buffer, data, ret);
+			}
+			return ret;
+		}
+	}
 
+	// select() leaves the remaining time in timeout, a dropped datagram does not extend the wait.
 	timeval timeout = pimpl->timeout;
+	for (;;) {
+		fd_set readset;
+		FD_ZERO(&readset);
+		FD_SET(pimpl->fd, &readset);
 
-	int ret = select(pimpl->fd + 1, &readset, NULL, NULL, &timeout);
+		if (select(pimpl->fd + 1, &readset, NULL, NULL, &timeout) <= 0) {
+			return -2;
+		}
 
-	if (ret > 0) {
-		ret = ::recvfrom(pimpl->fd, buffer, size, 0, NULL, NULL);
-	} else {
-		ret = -2;
+		int ret = ::recvfrom(pimpl->fd, buffer, size, MSG_TRUNC, NULL, NULL);
+		if (ret < 0 || static_cast<std::size_t>(ret) <= size) {
+			return ret;
+		}
+		// Longer than the buffer, drop it like the io_uring backend does.
+		++pimpl->truncated;
 	}
+}
 
-	return ret;
+int MulticastUdp::receive(const char*& data) {
+	if (pimpl->backend == MulticastUdpReceiveBackend_IoUring) {
+		int ret = pimpl->ioUring->receive(data, pimpl->timeout);
+		if (ret != IoUringReceiver::Unsupported) {
+			return ret;
+		}
+		LOG_MESSAGE(info)<< "recvmsg multishot no soportado, se usa select";
+		pimpl->ioUring->close();
+		pimpl->backend = MulticastUdpReceiveBackend_Select;
+	}
+
+	data = pimpl->readBuffer;
+	return recv(pimpl->readBuffer, MAX_BUFFER_SIZE);
+}
+
+void MulticastUdp::setReceiveBackend(MulticastUdpReceiveBackendEnum backend) {
+	pimpl->requestedBackend = backend;
+}
+
+MulticastUdpReceiveBackendEnum MulticastUdp::getReceiveBackend() {
+	return isOpen() ? pimpl->backend : pimpl->requestedBackend;
+}
+
+int64_t MulticastUdp::dropCount() {
+	uint32_t meminfo[SK_MEMINFO_VARS];
+	socklen_t len = sizeof(meminfo);
+	if (pimpl->fd < 0
+			|| getsockopt(pimpl->fd, SOL_SOCKET, SO_MEMINFO, meminfo, &len) != 0
+			|| len <= SK_MEMINFO_DROPS * sizeof(uint32_t)) {
+		return -1;
+	}
+	int64_t drops = meminfo[SK_MEMINFO_DROPS] + pimpl->truncated;
+	if (pimpl->backend == MulticastUdpReceiveBackend_IoUring) {
+		drops += pimpl->ioUring->truncatedCount();
+	}
+	return drops;
+}
+
+bool MulticastUdp::setSourceFilter(const std::vector<std::string>& sources) {
+	if (pimpl->active) {
+		LOG_MESSAGE(error)<< "No se puede cambiar el filtro de fuentes mientras se escucha";
+		return false;
+	}
+	std::vector<in_addr> addresses(sources.size());
+	for (std::size_t i = 0; i < sources.size(); ++i) {
+		if (inet_aton(sources[i].c_str(), &addresses[i]) == 0) {
+			LOG_MESSAGE(error)<< "Dirección de fuente no válida '" << sources[i] << "'";
+			return false;
+		}
+	}
+	pimpl->sources.swap(addresses);
+	return true;
+}
+
+bool MulticastUdp::setSocketFilter(
+		const std::vector<MulticastUdpFilterInstruction>& program) {
+	if (pimpl->active) {
+		LOG_MESSAGE(error)<< "No se puede cambiar el filtro del socket mientras se escucha";
+		return false;
+	}
+	std::vector<MulticastUdpFilterInstruction> previous(program);
+	pimpl->socketFilter.swap(previous);
+	if (!isOpen()) {
+		return true;
+	}
+	if (program.empty()) {
+		int unused = 0;
+		setsockopt(pimpl->fd, SOL_SOCKET, SO_DETACH_FILTER, &unused,
+				sizeof(unused));
+		return true;
+	}
+	if (!attachSocketFilter()) {
+		// The kernel keeps the previous program attached, keep it for the next open() too.
+		pimpl->socketFilter.swap(previous);
+		return false;
+	}
+	return true;
+}
+
+bool MulticastUdp::attachSocketFilter() {
+	static_assert(sizeof(MulticastUdpFilterInstruction) == sizeof(sock_filter),
+			"MulticastUdpFilterInstruction must match struct sock_filter");
+
+	sock_fprog program;
+	program.len = pimpl->socketFilter.size();
+	program.filter = reinterpret_cast<sock_filter*>(&pimpl->socketFilter[0]);
+	if (setsockopt(pimpl->fd, SOL_SOCKET, SO_ATTACH_FILTER, &program,
+			sizeof(program)) != 0) {
+		LOG_MESSAGE(error)<< "SO_ATTACH_FILTER '" << strerror(errno) << "'";
+		return false;
+	}
+	return true;
 }
 
 void MulticastUdp::setListener(std::shared_ptr<MulticastUdpListener> listener) {
@@ -251,11 +427,13 @@ void MulticastUdp::stopListening() {
 
 void MulticastUdp::runListener() {
 
+	const char* data;
+
 	while (pimpl->active) {
-		int ret = recv(pimpl->readBuffer, MAX_BUFFER_SIZE);
+		int ret = receive(data);
 
 		if (ret > 0) {
-			pimpl->listener->onDataAvailable(pimpl->readBuffer, ret);
+			pimpl->listener->onDataAvailable(data, ret);
 		} else if (ret == -2) {
 			pimpl->listener->onTimeout();
 		} else {
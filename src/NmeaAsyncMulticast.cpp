@@ -0,0 +1,97 @@
+/**
+ *	@file NmeaAsyncMulticast.cpp
+ *	@brief Implementation of the NmeaAsyncMulticast class
+ */
+
+#include "NmeaAsyncMulticast.h"
+
+#include <boost/asio/ip/multicast.hpp>
+#include <boost/log/trivial.hpp>
+
+#ifdef NM_DEBUG
+#define LOG_MESSAGE(lvl) BOOST_LOG_TRIVIAL(lvl)
+#else
+#define LOG_MESSAGE(lvl) if (false) BOOST_LOG_TRIVIAL(lvl)
+#endif
+
+using boost::asio::ip::udp;
+
+NmeaAsyncMulticast::NmeaAsyncMulticast(udp::socket& socket,
+		NmeaTrasmissionGroupEnum transmissionGroup) :
+		socket(socket), groupEndpoint(
+				boost::asio::ip::make_address_v4(
+						NmeaMulticastUdp::transmissionGroupAddress(
+								transmissionGroup)),
+				NmeaMulticastUdp::transmissionGroupPort(transmissionGroup)) {
+}
+
+void NmeaAsyncMulticast::joinGroup(udp::socket& socket,
+		NmeaTrasmissionGroupEnum transmissionGroup,
+		boost::system::error_code& ec) {
+	udp::endpoint group(
+			boost::asio::ip::make_address_v4(
+					NmeaMulticastUdp::transmissionGroupAddress(
+							transmissionGroup)),
+			NmeaMulticastUdp::transmissionGroupPort(transmissionGroup));
+
+	if (!socket.is_open()) {
+		socket.open(udp::v4(), ec);
+		if (ec) {
+			LOG_MESSAGE(error)<< "No se pudo crear socket '" << ec.message() << "'";
+			return;
+		}
+	}
+
+	socket.set_option(udp::socket::reuse_address(true), ec);
+	if (ec) {
+		LOG_MESSAGE(error)<< "No se pudo establecer REUSEADDR";
+		return;
+	}
+
+	socket.bind(group, ec);
+	if (ec) {
+		LOG_MESSAGE(error)<< "Error al hacer bind '" << ec.message() << "'";
+		return;
+	}
+
+	socket.set_option(boost::asio::ip::multicast::join_group(group.address()),
+			ec);
+	if (ec) {
+		LOG_MESSAGE(error)<< "No se pudo suscribir a la direccion multicast";
+		return;
+	}
+
+	socket.set_option(boost::asio::ip::multicast::enable_loopback(true), ec);
+	if (ec) {
+		LOG_MESSAGE(error)<< "No se pudo Habilitar loop";
+	}
+}
+
+void NmeaAsyncMulticast::registerSystemId(const std::string& sourceId) {
+	messageCounter[sourceId] = 1;
+}
+
+std::size_t NmeaAsyncMulticast::encode(const std::string& sourceId,
+		const std::string& nmea) {
+	int& counter = messageCounter[sourceId];
+
+	NmeaDatagramWriter writer(writebuffer, sizeof(writebuffer));
+	writer.writeTagBlock(sourceId.data(), sourceId.size(), counter);
+	writer.writeSentence(nmea.data(), nmea.size());
+
+	++counter;
+	if (counter == 1000) {
+		counter = 1;
+	}
+
+	return writer.isValid() ? writer.size() : 0;
+}
+
+std::size_t NmeaAsyncMulticast::parse(std::size_t size) {
+	NmeaDatagramReader reader(readbuffer, size);
+	std::size_t count = 0;
+	while (count < MaxSentences && reader.next(lines[count])) {
+		++count;
+	}
+	return count;
+}
@@ -0,0 +1,101 @@
+/**
+ *	@file NmeaBufferPool.cpp
+ *	@brief Implementation of the NmeaBufferPool class
+ */
+
+#include "NmeaBufferPool.h"
+
+const uint32_t emptyList = 0xffffffffu;
+const std::size_t slabAlignment = 64;
+
+static uint32_t listIndex(uint64_t head) {
+	return static_cast<uint32_t>(head);
+}
+
+static uint64_t listHead(uint64_t previous, uint32_t index) {
+	return (((previous >> 32) + 1) << 32) | index;
+}
+
+NmeaBufferPool::NmeaBufferPool(std::size_t bufferCount, std::size_t bufferSize) :
+		count(bufferCount), size(bufferSize), slots(new NmeaBufferSlot[bufferCount]), head(
+				emptyList), freeCount(bufferCount), peak(0), exhausted(0) {
+	// Each buffer starts on its own cache line.
+	std::size_t stride = (bufferSize + slabAlignment - 1) & ~(slabAlignment - 1);
+	slab.resize(bufferCount * stride + slabAlignment);
+	char* base = slab.data();
+	base += (slabAlignment
+			- reinterpret_cast<uintptr_t>(base) % slabAlignment) % slabAlignment;
+
+	for (std::size_t i = bufferCount; i > 0; --i) {
+		NmeaBufferSlot& slot = slots[i - 1];
+		slot.references.store(0, std::memory_order_relaxed);
+		slot.next.store(listIndex(head), std::memory_order_relaxed);
+		slot.index = i - 1;
+		slot.size = 0;
+		slot.data = base + (i - 1) * stride;
+		slot.pool = this;
+		head.store(i - 1, std::memory_order_relaxed);
+	}
+}
+
+NmeaBufferPool::~NmeaBufferPool() {
+}
+
+NmeaBuffer NmeaBufferPool::acquire() {
+	uint64_t current = head.load(std::memory_order_acquire);
+	for (;;) {
+		uint32_t index = listIndex(current);
+		if (index == emptyList) {
+			exhausted.fetch_add(1, std::memory_order_relaxed);
+			return NmeaBuffer();
+		}
+		uint32_t next = slots[index].next.load(std::memory_order_relaxed);
+		if (head.compare_exchange_weak(current, listHead(current, next),
+				std::memory_order_acquire, std::memory_order_acquire)) {
+			break;
+		}
+	}
+
+	NmeaBufferSlot* slot = &slots[listIndex(current)];
+	slot->references.store(1, std::memory_order_relaxed);
+	slot->size = 0;
+
+	std::size_t inUse = capacity()
+			- (freeCount.fetch_sub(1, std::memory_order_relaxed) - 1);
+	std::size_t previous = peak.load(std::memory_order_relaxed);
+	while (inUse > previous
+			&& !peak.compare_exchange_weak(previous, inUse,
+					std::memory_order_relaxed)) {
+	}
+
+	return NmeaBuffer(slot);
+}
+
+void NmeaBufferPool::release(NmeaBufferSlot* slot) {
+	uint64_t current = head.load(std::memory_order_relaxed);
+	do {
+		slot->next.store(listIndex(current), std::memory_order_relaxed);
+	} while (!head.compare_exchange_weak(current, listHead(current, slot->index),
+			std::memory_order_release, std::memory_order_relaxed));
+	freeCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::size_t NmeaBufferPool::capacity() const {
+	return count;
+}
+
+std::size_t NmeaBufferPool::bufferSize() const {
+	return size;
+}
+
+std::size_t NmeaBufferPool::available() const {
+	return freeCount.load(std::memory_order_relaxed);
+}
+
+std::size_t NmeaBufferPool::peakInUse() const {
+	return peak.load(std::memory_order_relaxed);
+}
+
+uint64_t NmeaBufferPool::exhaustedCount() const {
+	return exhausted.load(std::memory_order_relaxed);
+}
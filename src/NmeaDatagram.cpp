@@ -0,0 +1,206 @@
+/**
+ *	@file NmeaDatagram.cpp
+ *	@brief Implementation of the NMEA datagram parser
+ */
+
+#include "NmeaDatagram.h"
+
+#include <cstring>
+
+static const char* parseNumber(const char* p, const char* end,
+		unsigned& value) {
+	value = 0;
+	const char* start = p;
+	while (p < end && *p >= '0' && *p <= '9') {
+		value = value * 10 + (*p - '0');
+		++p;
+	}
+	return (p == start) ? nullptr : p;
+}
+
+static const char datagramHeader[NmeaDatagramHeaderSize] = { 'U', 'd', 'P',
+		'b', 'C', '\0' };
+
+NmeaDatagramReader::NmeaDatagramReader(const char* data, std::size_t size) :
+		current(data), end(data + size), valid(false) {
+	if (size >= NmeaDatagramHeaderSize
+			&& memcmp(data, datagramHeader, NmeaDatagramHeaderSize) == 0) {
+		valid = true;
+		current += NmeaDatagramHeaderSize;
+	}
+}
+
+bool NmeaDatagramReader::isValid() const {
+	return valid;
+}
+
+bool NmeaDatagramReader::next(NmeaDatagramLine& line) {
+	if (!valid) {
+		return false;
+	}
+
+	while (current < end && (*current == '\r' || *current == '\n')) {
+		++current;
+	}
+	if (current >= end) {
+		return false;
+	}
+
+	line.tagBlock = nullptr;
+	line.tagBlockSize = 0;
+	line.sourceId = nullptr;
+	line.sourceIdSize = 0;
+	line.groupLine = 0;
+	line.groupSize = 0;
+	line.groupId = 0;
+
+	if (*current == '\\') {
+		const char* tagStart = current + 1;
+		const char* tagEnd = static_cast<const char*>(memchr(tagStart, '\\',
+				end - tagStart));
+		if (tagEnd == nullptr) {
+			current = end;
+			return false;
+		}
+
+		const char* fieldsEnd = tagEnd;
+		for (const char* p = tagStart; p < tagEnd; ++p) {
+			if (*p == '*') {
+				fieldsEnd = p;
+				break;
+			}
+		}
+		line.tagBlock = tagStart;
+		line.tagBlockSize = fieldsEnd - tagStart;
+
+		const char* field = tagStart;
+		while (field < fieldsEnd) {
+			const char* fieldEnd = static_cast<const char*>(memchr(field, ',',
+					fieldsEnd - field));
+			if (fieldEnd == nullptr) {
+				fieldEnd = fieldsEnd;
+			}
+			if (fieldEnd - field >= 2 && field[0] == 's' && field[1] == ':') {
+				line.sourceId = field + 2;
+				line.sourceIdSize = fieldEnd - field - 2;
+			} else if (fieldEnd - field >= 2 && field[0] == 'g'
+					&& field[1] == ':') {
+				// "g:<line>-<size>-<id>"
+				unsigned groupLine, groupSize, groupId;
+				const char* p = parseNumber(field + 2, fieldEnd, groupLine);
+				if (p != nullptr && p < fieldEnd && *p == '-') {
+					p = parseNumber(p + 1, fieldEnd, groupSize);
+					if (p != nullptr && p < fieldEnd && *p == '-') {
+						p = parseNumber(p + 1, fieldEnd, groupId);
+						if (p == fieldEnd && groupLine >= 1
+								&& groupLine <= groupSize) {
+							line.groupLine = groupLine;
+							line.groupSize = groupSize;
+							line.groupId = groupId;
+						}
+					}
+				}
+			}
+			field = fieldEnd + 1;
+		}
+
+		current = tagEnd + 1;
+	}
+
+	const char* sentenceStart = current;
+	while (current < end && *current != '\r' && *current != '\n'
+			&& *current != '\\') {
+		++current;
+	}
+	line.sentence = sentenceStart;
+	line.sentenceSize = current - sentenceStart;
+
+	return true;
+}
+
+NmeaDatagramWriter::NmeaDatagramWriter(char* buffer, std::size_t capacity) :
+		buffer(buffer), capacity(capacity), position(0), valid(true) {
+	if (capacity >= NmeaDatagramHeaderSize) {
+		memcpy(buffer, datagramHeader, NmeaDatagramHeaderSize);
+		position = NmeaDatagramHeaderSize;
+	} else {
+		valid = false;
+	}
+}
+
+bool NmeaDatagramWriter::writeTagBlock(const char* sourceId,
+		std::size_t sourceIdSize, unsigned lineCount) {
+	static const char hex[] = "0123456789ABCDEF";
+
+	// "\s:" id ",n:" digits "*hh\"
+	std::size_t tagSize = tagBlockSize(sourceIdSize, lineCount);
+
+	char digits[10];
+	std::size_t digitCount = 0;
+	do {
+		digits[digitCount++] = '0' + (lineCount % 10);
+		lineCount /= 10;
+	} while (lineCount > 0);
+
+	if (!valid || capacity - position < tagSize) {
+		valid = false;
+		return false;
+	}
+
+	char* p = &buffer[position];
+	char* checksumStart = p + 1;
+	*p++ = '\\';
+	*p++ = 's';
+	*p++ = ':';
+	memcpy(p, sourceId, sourceIdSize);
+	p += sourceIdSize;
+	*p++ = ',';
+	*p++ = 'n';
+	*p++ = ':';
+	while (digitCount > 0) {
+		*p++ = digits[--digitCount];
+	}
+
+	unsigned char checksum = 0;
+	for (const char* c = checksumStart; c < p; ++c) {
+		checksum ^= static_cast<unsigned char>(*c);
+	}
+	*p++ = '*';
+	*p++ = hex[checksum >> 4];
+	*p++ = hex[checksum & 0x0f];
+	*p++ = '\\';
+
+	position += tagSize;
+	return true;
+}
+
+bool NmeaDatagramWriter::writeSentence(const char* sentence,
+		std::size_t sentenceSize) {
+	if (!valid || capacity - position < sentenceSize + 2) {
+		valid = false;
+		return false;
+	}
+	memcpy(&buffer[position], sentence, sentenceSize);
+	position += sentenceSize;
+	buffer[position++] = '\r';
+	buffer[position++] = '\n';
+	return true;
+}
+
+std::size_t NmeaDatagramWriter::tagBlockSize(std::size_t sourceIdSize,
+		unsigned lineCount) {
+	std::size_t digitCount = 1;
+	while (lineCount >= 10) {
+		lineCount /= 10;
+		++digitCount;
+	}
+	return 3 + sourceIdSize + 3 + digitCount + 4;
+}
+
+std::size_t NmeaDatagramWriter::size() const {
+	return position;
+}
+
+bool NmeaDatagramWriter::isValid() const {
+	return valid;
+}
@@ -0,0 +1,152 @@
+/**
+ *	@file NmeaGroupAssembler.cpp
+ *	@brief Implementation of the internal NmeaGroupAssembler class
+ */
+
+#include "NmeaGroupAssembler.h"
+
+#include <cstring>
+
+NmeaGroupAssembler::NmeaGroupAssembler(std::size_t slotCount,
+		std::size_t slotSize, std::chrono::milliseconds timeout) :
+		slotSize(slotSize), timeout(timeout), slots(slotCount), storage(
+				slotCount * slotSize), output(slotSize), dropped(0) {
+	for (auto& slot : slots) {
+		slot.used = false;
+	}
+}
+
+bool NmeaGroupAssembler::add(const NmeaDatagramLine& line, const char*& block,
+		std::size_t& size, std::size_t& lines) {
+	if (line.groupSize == 0 || line.groupSize > MaxGroupLines
+			|| line.sourceIdSize > MaxSourceIdSize) {
+		++dropped;
+		return false;
+	}
+
+	auto now = std::chrono::steady_clock::now();
+	Slot* slot = find(line, now);
+	if (slot == nullptr) {
+		return false;
+	}
+
+	uint64_t bit = uint64_t(1) << (line.groupLine - 1);
+	if (slot->mask & bit) {
+		// Repeated line, keep the first copy.
+		return false;
+	}
+
+	if (slot->fill + line.sentenceSize + 2 > slotSize) {
+		slot->used = false;
+		++dropped;
+		return false;
+	}
+
+	char* p = data(*slot) + slot->fill;
+	memcpy(p, line.sentence, line.sentenceSize);
+	p[line.sentenceSize] = '\r';
+	p[line.sentenceSize + 1] = '\n';
+
+	unsigned index = line.groupLine - 1;
+	slot->offset[index] = slot->fill;
+	slot->length[index] = line.sentenceSize + 2;
+	slot->fill += line.sentenceSize + 2;
+	if (index != slot->received) {
+		slot->ordered = false;
+	}
+	++slot->received;
+	slot->mask |= bit;
+
+	if (slot->received < slot->groupSize) {
+		return false;
+	}
+
+	if (slot->ordered) {
+		block = data(*slot);
+		size = slot->fill;
+	} else {
+		std::size_t position = 0;
+		for (unsigned i = 0; i < slot->groupSize; ++i) {
+			memcpy(&output[position], data(*slot) + slot->offset[i],
+					slot->length[i]);
+			position += slot->length[i];
+		}
+		block = output.data();
+		size = position;
+	}
+	lines = slot->groupSize;
+	slot->used = false;
+	return true;
+}
+
+void NmeaGroupAssembler::expire() {
+	auto now = std::chrono::steady_clock::now();
+	for (auto& slot : slots) {
+		if (slot.used && now - slot.started > timeout) {
+			slot.used = false;
+			++dropped;
+		}
+	}
+}
+
+uint64_t NmeaGroupAssembler::droppedCount() const {
+	return dropped;
+}
+
+NmeaGroupAssembler::Slot* NmeaGroupAssembler::find(
+		const NmeaDatagramLine& line, std::chrono::steady_clock::time_point now) {
+	Slot* freeSlot = nullptr;
+	Slot* oldest = nullptr;
+
+	for (auto& slot : slots) {
+		if (!slot.used) {
+			if (freeSlot == nullptr) {
+				freeSlot = &slot;
+			}
+			continue;
+		}
+		if (slot.groupId == line.groupId && slot.groupSize == line.groupSize
+				&& slot.sourceIdSize == line.sourceIdSize
+				&& memcmp(slot.sourceId, line.sourceId, line.sourceIdSize)
+						== 0) {
+			if (now - slot.started <= timeout) {
+				return &slot;
+			}
+			// Stale group with a reused Id, start over.
+			slot.used = false;
+			++dropped;
+			freeSlot = &slot;
+			break;
+		}
+		if (oldest == nullptr || slot.started < oldest->started) {
+			oldest = &slot;
+		}
+	}
+
+	if (freeSlot == nullptr) {
+		if (oldest == nullptr) {
+			// No slots at all.
+			++dropped;
+			return nullptr;
+		}
+		++dropped;
+		freeSlot = oldest;
+	}
+
+	Slot& slot = *freeSlot;
+	slot.used = true;
+	memcpy(slot.sourceId, line.sourceId, line.sourceIdSize);
+	slot.sourceIdSize = line.sourceIdSize;
+	slot.groupId = line.groupId;
+	slot.groupSize = line.groupSize;
+	slot.received = 0;
+	slot.mask = 0;
+	slot.ordered = true;
+	slot.fill = 0;
+	slot.started = now;
+	return &slot;
+}
+
+char* NmeaGroupAssembler::data(const Slot& slot) {
+	return &storage[(&slot - slots.data()) * slotSize];
+}
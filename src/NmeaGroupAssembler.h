@@ -0,0 +1,92 @@
+/**
+*	@file NmeaGroupAssembler.h
+*	@brief Header for the internal NmeaGroupAssembler class
+*/
+
+#ifndef SRC_NMEAGROUPASSEMBLER_H_
+#define SRC_NMEAGROUPASSEMBLER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "NmeaDatagram.h"
+
+/**
+ * @brief Assembles TAG block sentence groups ("g:" parameter) used by NmeaMulticastUdp.
+ *
+ * Lines are collected in a pool of slots allocated once at construction, keyed by source Id and group Id.
+ * When the last line of a group arrives the group is returned as one contiguous block of sentences separated
+ * by "\r\n", in line order. Groups not completed within the timeout, or evicted because every slot is busy,
+ * are dropped and counted.
+ */
+class NmeaGroupAssembler {
+public:
+	/**
+	 * @brief Maximum number of lines in a group.
+	 */
+	static const unsigned MaxGroupLines = 64;
+
+	/**
+	 * @brief Constructor
+	 *
+	 * @param [in] slotCount Number of groups assembled at the same time.
+	 * @param [in] slotSize Maximum size in bytes of an assembled group.
+	 * @param [in] timeout Maximum time between the first and the last line of a group.
+	 */
+	NmeaGroupAssembler(std::size_t slotCount, std::size_t slotSize,
+			std::chrono::milliseconds timeout);
+
+	/**
+	 * @brief Add a line with a "g:" TAG block parameter.
+	 *
+	 * @param [in] line Parsed line, groupSize must not be 0.
+	 * @param [out] block Assembled group when complete. Valid until the next call to add().
+	 * @param [out] size Size of the assembled group.
+	 * @param [out] lines Number of sentences in the assembled group.
+	 *
+	 * @return True if the line completed a group.
+	 */
+	bool add(const NmeaDatagramLine& line, const char*& block,
+			std::size_t& size, std::size_t& lines);
+
+	/**
+	 * @brief Drop the groups older than the timeout.
+	 */
+	void expire();
+
+	/**
+	 * @brief Number of incomplete groups dropped by timeout or eviction.
+	 */
+	uint64_t droppedCount() const;
+
+private:
+	static const std::size_t MaxSourceIdSize = 16;
+
+	struct Slot {
+		bool used;
+		char sourceId[MaxSourceIdSize];
+		std::size_t sourceIdSize;
+		unsigned groupId;
+		unsigned groupSize;
+		unsigned received;
+		uint64_t mask;
+		bool ordered;
+		std::size_t fill;
+		std::chrono::steady_clock::time_point started;
+		uint32_t offset[MaxGroupLines];
+		uint32_t length[MaxGroupLines];
+	};
+
+	std::size_t slotSize;
+	std::chrono::milliseconds timeout;
+	std::vector<Slot> slots;
+	std::vector<char> storage;
+	std::vector<char> output;
+	uint64_t dropped;
+
+	Slot* find(const NmeaDatagramLine& line, std::chrono::steady_clock::time_point now);
+	char* data(const Slot& slot);
+};
+
+#endif /* SRC_NMEAGROUPASSEMBLER_H_ */
@@ -0,0 +1,258 @@
+/**
+ *	@file NmeaLatestValueCache.cpp
+ *	@brief Implementation of the NmeaLatestValueCache class
+ */
+
+#include "NmeaLatestValueCache.h"
+
+#include <algorithm>
+#include <cstring>
+
+const std::size_t sourceIdMaxSize = 7;
+const std::size_t addressSize = 5;
+const std::size_t keyMaxSize = sourceIdMaxSize + 1 + addressSize;
+const std::size_t payloadWords = NmeaLatestValueMaxSentence / sizeof(uint64_t);
+
+struct NmeaLatestValueCache::Slot {
+	// Key is written once by the writer before 'claimed' is published and never changes afterwards.
+	std::atomic<bool> claimed;
+	char key[keyMaxSize + 1];
+	std::size_t keyLen;
+	std::size_t sourceIdLen;
+
+	// Value is protected by the sequence lock. Odd sequence means a write is in progress.
+	std::atomic<uint32_t> seq;
+	std::atomic<uint32_t> length;
+	std::atomic<int64_t> received;
+	std::atomic<uint64_t> words[payloadWords];
+};
+
+static std::size_t makeKey(const std::string& sourceId, const char* address,
+		char* key) {
+	if (sourceId.size() > sourceIdMaxSize) {
+		return 0;
+	}
+	std::size_t len = sourceId.size();
+	memcpy(key, sourceId.data(), len);
+	key[len++] = ',';
+	memcpy(&key[len], address, addressSize);
+	len += addressSize;
+	return len;
+}
+
+static std::size_t hashKey(const char* key, std::size_t len) {
+	// FNV-1a
+	uint32_t h = 2166136261u;
+	for (std::size_t i = 0; i < len; ++i) {
+		h ^= static_cast<unsigned char>(key[i]);
+		h *= 16777619u;
+	}
+	return h;
+}
+
+NmeaLatestValueCache::NmeaLatestValueCache(std::size_t capacity) :
+		used(0), overflowCount(0) {
+	std::size_t size = 1;
+	while (size < capacity) {
+		size <<= 1;
+	}
+	mask = size - 1;
+	slots.reset(new Slot[size]);
+	for (std::size_t i = 0; i < size; ++i) {
+		Slot& slot = slots[i];
+		slot.claimed.store(false, std::memory_order_relaxed);
+		slot.keyLen = 0;
+		slot.sourceIdLen = 0;
+		slot.seq.store(0, std::memory_order_relaxed);
+		slot.length.store(0, std::memory_order_relaxed);
+		slot.received.store(0, std::memory_order_relaxed);
+		for (std::size_t w = 0; w < payloadWords; ++w) {
+			slot.words[w].store(0, std::memory_order_relaxed);
+		}
+	}
+	std::atomic_thread_fence(std::memory_order_release);
+}
+
+NmeaLatestValueCache::~NmeaLatestValueCache() {
+}
+
+bool NmeaLatestValueCache::update(const std::string& sourceId,
+		const std::string& nmea) {
+	if (nmea.size() < 1 + addressSize || (nmea[0] != '$' && nmea[0] != '!')) {
+		return false;
+	}
+
+	char key[keyMaxSize];
+	std::size_t keyLen = makeKey(sourceId, &nmea[1], key);
+	if (keyLen == 0) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(writerMutex);
+
+	Slot* slot = nullptr;
+	std::size_t index = hashKey(key, keyLen) & mask;
+	for (std::size_t probe = 0; probe <= mask; ++probe) {
+		Slot& candidate = slots[(index + probe) & mask];
+		if (!candidate.claimed.load(std::memory_order_relaxed)) {
+			memcpy(candidate.key, key, keyLen);
+			candidate.key[keyLen] = '\0';
+			candidate.keyLen = keyLen;
+			candidate.sourceIdLen = sourceId.size();
+			candidate.claimed.store(true, std::memory_order_release);
+			used.fetch_add(1, std::memory_order_relaxed);
+			slot = &candidate;
+			break;
+		}
+		if (candidate.keyLen == keyLen
+				&& memcmp(candidate.key, key, keyLen) == 0) {
+			slot = &candidate;
+			break;
+		}
+	}
+
+	if (slot == nullptr) {
+		overflowCount.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	uint64_t words[payloadWords] = { };
+	std::size_t length = std::min(nmea.size(), NmeaLatestValueMaxSentence - 1);
+	memcpy(words, nmea.data(), length);
+
+	int64_t now =
+			std::chrono::steady_clock::now().time_since_epoch().count();
+
+	uint32_t seq = slot->seq.load(std::memory_order_relaxed);
+	slot->seq.store(seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	slot->length.store(length, std::memory_order_relaxed);
+	slot->received.store(now, std::memory_order_relaxed);
+	for (std::size_t w = 0; w < payloadWords; ++w) {
+		slot->words[w].store(words[w], std::memory_order_relaxed);
+	}
+
+	slot->seq.store(seq + 2, std::memory_order_release);
+
+	return true;
+}
+
+bool NmeaLatestValueCache::snapshot(const std::string& sourceId,
+		const std::string& address, NmeaLatestValue& value) const {
+	if (address.size() != addressSize) {
+		return false;
+	}
+	char key[keyMaxSize];
+	std::size_t keyLen = makeKey(sourceId, address.data(), key);
+	if (keyLen == 0) {
+		return false;
+	}
+	const Slot* slot = find(key, keyLen);
+	return (slot != nullptr) && read(*slot, value);
+}
+
+bool NmeaLatestValueCache::snapshotAt(std::size_t index,
+		NmeaLatestValue& value) const {
+	if (index > mask || !slots[index].claimed.load(std::memory_order_acquire)) {
+		return false;
+	}
+	return read(slots[index], value);
+}
+
+bool NmeaLatestValueCache::age(const std::string& sourceId,
+		const std::string& address,
+		std::chrono::steady_clock::duration& age) const {
+	if (address.size() != addressSize) {
+		return false;
+	}
+	char key[keyMaxSize];
+	std::size_t keyLen = makeKey(sourceId, address.data(), key);
+	if (keyLen == 0) {
+		return false;
+	}
+	const Slot* slot = find(key, keyLen);
+	if (slot == nullptr) {
+		return false;
+	}
+	return ageAt(slot - slots.get(), age);
+}
+
+bool NmeaLatestValueCache::ageAt(std::size_t index,
+		std::chrono::steady_clock::duration& age) const {
+	if (index > mask || !slots[index].claimed.load(std::memory_order_acquire)
+			|| slots[index].seq.load(std::memory_order_acquire) == 0) {
+		return false;
+	}
+	// A single atomic word, no need for the sequence lock.
+	std::chrono::steady_clock::duration received(
+			slots[index].received.load(std::memory_order_acquire));
+	age = std::chrono::steady_clock::now().time_since_epoch() - received;
+	return true;
+}
+
+std::size_t NmeaLatestValueCache::capacity() const {
+	return mask + 1;
+}
+
+std::size_t NmeaLatestValueCache::size() const {
+	return used.load(std::memory_order_relaxed);
+}
+
+uint64_t NmeaLatestValueCache::overflows() const {
+	return overflowCount.load(std::memory_order_relaxed);
+}
+
+const NmeaLatestValueCache::Slot* NmeaLatestValueCache::find(const char* key,
+		std::size_t keyLen) const {
+	std::size_t index = hashKey(key, keyLen) & mask;
+	for (std::size_t probe = 0; probe <= mask; ++probe) {
+		const Slot& candidate = slots[(index + probe) & mask];
+		if (!candidate.claimed.load(std::memory_order_acquire)) {
+			return nullptr;
+		}
+		if (candidate.keyLen == keyLen
+				&& memcmp(candidate.key, key, keyLen) == 0) {
+			return &candidate;
+		}
+	}
+	return nullptr;
+}
+
+bool NmeaLatestValueCache::read(const Slot& slot, NmeaLatestValue& value) const {
+	uint64_t words[payloadWords];
+	uint32_t length;
+	int64_t received;
+	uint32_t seqBefore;
+	uint32_t seqAfter;
+
+	do {
+		seqBefore = slot.seq.load(std::memory_order_acquire);
+		if (seqBefore & 1) {
+			continue;
+		}
+		length = slot.length.load(std::memory_order_relaxed);
+		received = slot.received.load(std::memory_order_relaxed);
+		for (std::size_t w = 0; w < payloadWords; ++w) {
+			words[w] = slot.words[w].load(std::memory_order_relaxed);
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		seqAfter = slot.seq.load(std::memory_order_relaxed);
+	} while ((seqBefore & 1) || seqBefore != seqAfter);
+
+	if (seqBefore == 0) {
+		// Slot claimed but value not yet published.
+		return false;
+	}
+
+	memcpy(value.sourceId, slot.key, slot.sourceIdLen);
+	value.sourceId[slot.sourceIdLen] = '\0';
+	memcpy(value.address, &slot.key[slot.sourceIdLen + 1], addressSize);
+	value.address[addressSize] = '\0';
+	memcpy(value.sentence, words, length);
+	value.sentence[length] = '\0';
+	value.length = length;
+	value.received = std::chrono::steady_clock::time_point(
+			std::chrono::steady_clock::duration(received));
+	return true;
+}
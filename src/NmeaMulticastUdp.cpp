@@ -7,10 +7,25 @@
 
 #include "NmeaMulticastUdpListener.h"
 
+#include "NmeaLatestValueCache.h"
+
+#include "NmeaDatagram.h"
+
+#include "NmeaGroupAssembler.h"
+
+#include "NmeaBufferPool.h"
+
+#include "NmeaStatistics.h"
+
+#include "NmeaSocketFilter.h"
+
 #include "MulticastUdp.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <unordered_map>
-#include <boost/tokenizer.hpp>
+#include <vector>
 #include <boost/thread.hpp>
 #include <boost/log/trivial.hpp>
 
@@ -50,12 +65,24 @@ using namespace boost;
 const int defaultTimeout = 1000;
 const int multicastBufferSize = 4096;
 const int nmeaStringMaxSize = 2048;
+const std::size_t nmeaAddressSize = 5;
+const std::size_t groupSlotSize = 8192;
+const unsigned kernelDropsInterval = 256;
 
-char DatagramHeader[6] = { 'U', 'd', 'P', 'b', 'C', '\0' };
+struct ConflatedEntry {
+	std::string sourceId;
+	std::string nmea;
+	bool pending;
+};
 
 class NmeaMulticastUdp::impl {
 public:
-	bool active;
+	std::atomic<bool> active;
+
+	NmeaTrasmissionGroupEnum transmissionGroup;
+
+	NmeaDeliveryModeEnum deliveryMode;
+	std::size_t conflationMaxKeys;
 
 	std::shared_ptr<MulticastUdp> multicast;
 
@@ -63,20 +90,65 @@ public:
 
 	thread listenerThread;
 	std::shared_ptr<NmeaMulticastUdpListener> listener;
+	std::shared_ptr<NmeaLatestValueCache> latestValueCache;
+	std::shared_ptr<NmeaBufferPool> bufferPool;
+	std::shared_ptr<NmeaStatistics> statistics;
+	unsigned statisticsDatagrams;
+
+	thread dispatchThread;
+	mutex conflationMutex;
+	condition_variable conflationCondition;
+	std::unordered_map<std::string, std::size_t> conflationIndex;
+	std::vector<ConflatedEntry> conflationEntries;
+	std::vector<std::size_t> conflationPending;
+	std::string conflationKey;
+	bool conflationTimeout;
+	uint64_t conflated;
+	uint64_t conflationOverflows;
+
+	bool groupAssembly;
+	std::size_t groupSlots;
+	int groupTimeout;
+	std::unique_ptr<NmeaGroupAssembler> groupAssembler;
+	std::atomic<uint64_t> groupDropped;
+	std::atomic<uint64_t> poolDropped;
 
-	char readbuffer[multicastBufferSize];
 	char writebuffer[multicastBufferSize];
 };
 
 NmeaMulticastUdp::NmeaMulticastUdp(const NmeaMulticastUdp& obj) :
 		pimpl { new impl } {
 	pimpl->active = false;
+	pimpl->transmissionGroup = obj.pimpl->transmissionGroup;
+	pimpl->statisticsDatagrams = 0;
+	pimpl->deliveryMode = obj.pimpl->deliveryMode;
+	pimpl->conflationMaxKeys = obj.pimpl->conflationMaxKeys;
+	pimpl->groupAssembly = obj.pimpl->groupAssembly;
+	pimpl->groupSlots = obj.pimpl->groupSlots;
+	pimpl->groupTimeout = obj.pimpl->groupTimeout;
+	pimpl->groupDropped = 0;
+	pimpl->poolDropped = 0;
+	pimpl->conflationTimeout = false;
+	pimpl->conflated = 0;
+	pimpl->conflationOverflows = 0;
 	pimpl->multicast = std::make_shared<MulticastUdp>(*obj.pimpl->multicast);
 }
 
 NmeaMulticastUdp::NmeaMulticastUdp(NmeaTrasmissionGroupEnum transmissionGroup) :
 		pimpl { new impl } {
 	pimpl->active = false;
+	pimpl->transmissionGroup = transmissionGroup;
+	pimpl->statisticsDatagrams = 0;
+	pimpl->deliveryMode = NmeaDeliveryMode_Direct;
+	pimpl->conflationMaxKeys = 0;
+	pimpl->groupAssembly = false;
+	pimpl->groupSlots = 0;
+	pimpl->groupTimeout = 0;
+	pimpl->groupDropped = 0;
+	pimpl->poolDropped = 0;
+	pimpl->conflationTimeout = false;
+	pimpl->conflated = 0;
+	pimpl->conflationOverflows = 0;
 	pimpl->multicast = std::make_shared<MulticastUdp>(std::string("0.0.0.0"),
 			NmeaTrasmissionGroupMap[transmissionGroup].first,
 			NmeaTrasmissionGroupMap[transmissionGroup].second, defaultTimeout);
@@ -85,6 +157,7 @@ NmeaMulticastUdp::NmeaMulticastUdp(NmeaTrasmissionGroupEnum transmissionGroup) :
 
 NmeaMulticastUdp::~NmeaMulticastUdp() {
 	stopListening();
+	unsetStatistics();
 }
 
 bool NmeaMulticastUdp::open() {
@@ -99,82 +172,69 @@ bool NmeaMulticastUdp::isOpen() {
 	return pimpl->multicast->isOpen();
 }
 
+void NmeaMulticastUdp::setReceiveBackend(
+		MulticastUdpReceiveBackendEnum backend) {
+	pimpl->multicast->setReceiveBackend(backend);
+}
+
+MulticastUdpReceiveBackendEnum NmeaMulticastUdp::getReceiveBackend() {
+	return pimpl->multicast->getReceiveBackend();
+}
+
 void NmeaMulticastUdp::registerSystemId(const std::string& sourceId) {
 	pimpl->messageCounter[sourceId] = 1;
 }
 
 bool NmeaMulticastUdp::sendString(const std::string& sourceId,
 		const std::string& nmea) {
-	int pointer = 0;
-	memcpy(&pimpl->writebuffer[pointer], DatagramHeader,
-			sizeof(DatagramHeader));
-	pointer += sizeof(DatagramHeader);
+	NmeaDatagramWriter writer = startDatagram(sourceId);
+	writer.writeSentence(nmea.data(), nmea.size());
+	return sendDatagram(writer);
+}
 
+NmeaDatagramWriter NmeaMulticastUdp::startDatagram(
+		const std::string& sourceId) {
 	int& messageCounter = pimpl->messageCounter[sourceId];
 
-	std::stringstream tagBlockss;
-	tagBlockss << "s:" << sourceId;
-	tagBlockss << ",n:" << messageCounter;
+	NmeaDatagramWriter writer(pimpl->writebuffer, multicastBufferSize);
+	writer.writeTagBlock(sourceId.data(), sourceId.size(), messageCounter);
 
 	++messageCounter;
 	if (messageCounter == 1000) {
 		messageCounter = 1;
 	}
+	return writer;
+}
 
-	int16_t checksum = calculateNmeaChecksum(tagBlockss.str());
-
-	tagBlockss << "*" << std::hex << std::uppercase << std::setfill('0')
-			<< std::setw(2) << checksum;
-
-	std::string tagBlock = tagBlockss.str();
-
-	pimpl->writebuffer[pointer] = '\\';
-	++pointer;
-
-	for (auto c : tagBlock) {
-		pimpl->writebuffer[pointer] = c;
-		++pointer;
-	}
-
-	pimpl->writebuffer[pointer] = '\\';
-	++pointer;
-
-	for (auto c : nmea) {
-		pimpl->writebuffer[pointer] = c;
-		++pointer;
+bool NmeaMulticastUdp::sendDatagram(const NmeaDatagramWriter& writer) {
+	if (!writer.isValid()) {
+		LOG_MESSAGE(error)<< "Cadena demasiado larga para el datagrama";
+		return false;
 	}
 
-	pimpl->writebuffer[pointer] = '\r';
-	++pointer;
-	pimpl->writebuffer[pointer] = '\n';
-	++pointer;
-
-	return (pimpl->multicast->send(pimpl->writebuffer, pointer) > 0);
+	return (pimpl->multicast->send(pimpl->writebuffer, writer.size()) > 0);
 }
 
 bool NmeaMulticastUdp::recvString(std::string& sourceId, std::string& nmea) {
 	bool ret = false;
 
-	int len = pimpl->multicast->recv(pimpl->readbuffer, multicastBufferSize);
+	const char* readbuffer;
+	int len = pimpl->multicast->receive(readbuffer);
 
 	if (len > 0) {
-		if (memcmp(pimpl->readbuffer, DatagramHeader, sizeof(DatagramHeader))
-				== 0) {
+		NmeaDatagramReader reader(readbuffer, len);
+		NmeaDatagramLine line;
+		if (reader.next(line)) {
 			ret = true;
-			std::string nmeaBlocks(&pimpl->readbuffer[sizeof(DatagramHeader)],
-					len - sizeof(DatagramHeader));
-			const boost::char_separator<char> sep("\\\r\n");
-			const boost::tokenizer<boost::char_separator<char>> t(
-					nmeaBlocks.begin(), nmeaBlocks.end(), sep);
-
-			// FIXME: Se asume que la cadena es "s:ID0001,n:11*cc"
-			boost::tokenizer<boost::char_separator<char>>::iterator itToken =
-					t.begin();
-			sourceId = (*itToken).substr(2, 6);
-			++itToken;
-			nmea = (*itToken);
+			sourceId.assign(line.sourceId, line.sourceIdSize);
+			nmea.assign(line.sentence, line.sentenceSize);
+			if (pimpl->statistics) {
+				pimpl->statistics->recordSentence(pimpl->transmissionGroup,
+						line.sourceId, line.sourceIdSize, line.sentenceSize);
+			}
 		}
 	}
+	recordReceive(len, ret);
 	return ret;
 }
 
@@ -187,15 +247,149 @@ void NmeaMulticastUdp::unsetListener() {
 	pimpl->listener.reset();
 }
 
+void NmeaMulticastUdp::setLatestValueCache(
+		std::shared_ptr<NmeaLatestValueCache> cache) {
+	pimpl->latestValueCache = cache;
+}
+
+void NmeaMulticastUdp::unsetLatestValueCache() {
+	pimpl->latestValueCache.reset();
+}
+
+void NmeaMulticastUdp::setBufferPool(std::shared_ptr<NmeaBufferPool> pool) {
+	if (!pimpl->active) {
+		pimpl->bufferPool = pool;
+	}
+}
+
+void NmeaMulticastUdp::unsetBufferPool() {
+	if (!pimpl->active) {
+		pimpl->bufferPool.reset();
+	}
+}
+
+bool NmeaMulticastUdp::setStatistics(
+		std::shared_ptr<NmeaStatistics> statistics) {
+	if (pimpl->active) {
+		return false;
+	}
+	if (statistics == pimpl->statistics) {
+		return true;
+	}
+	if (statistics && !statistics->acquireGroup(pimpl->transmissionGroup)) {
+		LOG_MESSAGE(error)<< "El grupo ya publica estadísticas desde otro objeto";
+		return false;
+	}
+	if (pimpl->statistics) {
+		pimpl->statistics->releaseGroup(pimpl->transmissionGroup);
+	}
+	pimpl->statistics = statistics;
+	return true;
+}
+
+void NmeaMulticastUdp::unsetStatistics() {
+	if (!pimpl->active && pimpl->statistics) {
+		pimpl->statistics->releaseGroup(pimpl->transmissionGroup);
+		pimpl->statistics.reset();
+	}
+}
+
+void NmeaMulticastUdp::setDeliveryMode(NmeaDeliveryModeEnum mode,
+		std::size_t maxKeys) {
+	if (!pimpl->active) {
+		pimpl->deliveryMode = mode;
+		pimpl->conflationMaxKeys = maxKeys;
+	}
+}
+
+uint64_t NmeaMulticastUdp::conflatedCount() {
+	lock_guard<mutex> lock(pimpl->conflationMutex);
+	return pimpl->conflated;
+}
+
+uint64_t NmeaMulticastUdp::conflationOverflowCount() {
+	lock_guard<mutex> lock(pimpl->conflationMutex);
+	return pimpl->conflationOverflows;
+}
+
+bool NmeaMulticastUdp::setSourceFilter(
+		const std::vector<std::string>& sources) {
+	if (pimpl->active) {
+		LOG_MESSAGE(error)<< "No se puede cambiar el filtro de fuentes mientras se escucha";
+		return false;
+	}
+	return pimpl->multicast->setSourceFilter(sources);
+}
+
+bool NmeaMulticastUdp::setKernelFilter(bool enable,
+		const std::vector<std::string>& formatters) {
+	if (pimpl->active) {
+		LOG_MESSAGE(error)<< "No se puede cambiar el filtro del socket mientras se escucha";
+		return false;
+	}
+	std::vector<MulticastUdpFilterInstruction> program;
+	if (enable && !nmeaSocketFilter(formatters, program)) {
+		LOG_MESSAGE(error)<< "Filtro de formateadores no válido";
+		return false;
+	}
+	return pimpl->multicast->setSocketFilter(program);
+}
+
+bool NmeaMulticastUdp::setGroupAssembly(bool enable, std::size_t slots,
+		int timeout) {
+	if (pimpl->active) {
+		return false;
+	}
+	if (enable && (slots == 0 || timeout <= 0)) {
+		LOG_MESSAGE(error)<< "Ensamblado de grupos sin huecos o sin plazo";
+		return false;
+	}
+	pimpl->groupAssembly = enable;
+	pimpl->groupSlots = slots;
+	pimpl->groupTimeout = timeout;
+	return true;
+}
+
+uint64_t NmeaMulticastUdp::groupDroppedCount() {
+	return pimpl->groupDropped;
+}
+
+uint64_t NmeaMulticastUdp::poolDroppedCount() {
+	return pimpl->poolDropped;
+}
+
 bool NmeaMulticastUdp::startListening() {
 	LOG_MESSAGE(trace)<< "NmeaMulticastUdp::startListening >>>>";
 	bool ret = false;
 
-	if (!pimpl->active && pimpl->listener) {
+	if (pimpl->groupAssembly && pimpl->listener
+			&& pimpl->deliveryMode == NmeaDeliveryMode_Conflated) {
+		// Groups would reach the listener from the receiving thread and strings from the dispatch thread.
+		LOG_MESSAGE(error)<< "Ensamblado de grupos no disponible en modo agregado";
+	} else if (!pimpl->active && (pimpl->listener || pimpl->latestValueCache)) {
 		if (pimpl->multicast->open()) {
 			pimpl->active = true;
 			ret = true;
 
+			if (pimpl->deliveryMode == NmeaDeliveryMode_Conflated
+					&& pimpl->listener) {
+				pimpl->conflationEntries.reserve(pimpl->conflationMaxKeys);
+				pimpl->conflationPending.reserve(pimpl->conflationMaxKeys);
+				pimpl->conflationIndex.reserve(pimpl->conflationMaxKeys);
+				thread d(bind(&NmeaMulticastUdp::runDispatcher, this));
+				pimpl->dispatchThread.swap(d);
+			}
+
+			if (pimpl->groupAssembly) {
+				pimpl->groupAssembler.reset(
+						new NmeaGroupAssembler(pimpl->groupSlots,
+								groupSlotSize,
+								std::chrono::milliseconds(
+										pimpl->groupTimeout)));
+			} else {
+				pimpl->groupAssembler.reset();
+			}
+
 			thread t(bind(&NmeaMulticastUdp::runListener, this));
 			pimpl->listenerThread.swap(t);
 			LOG_MESSAGE(debug) << "NmeaMulticastUdp::startListening se inicia hilo";
@@ -210,6 +404,13 @@ void NmeaMulticastUdp::stopListening() {
 	if (pimpl->active) {
 		pimpl->active = false;
 		pimpl->listenerThread.join();
+		if (pimpl->dispatchThread.joinable()) {
+			{
+				lock_guard<mutex> lock(pimpl->conflationMutex);
+				pimpl->conflationCondition.notify_all();
+			}
+			pimpl->dispatchThread.join();
+		}
 		pimpl->multicast->close();
 		LOG_MESSAGE(debug) << "NmeaMulticastUdp::stopListening: se liberó hilo";
 	}
@@ -220,14 +421,306 @@ void NmeaMulticastUdp::runListener() {
 	std::string sourceId;
 	std::string nmeaStr;
 
+	bool conflated = pimpl->dispatchThread.joinable();
+
+	if (pimpl->groupAssembler) {
+		runGroupListener();
+		return;
+	}
+
+	if (pimpl->bufferPool && !conflated && pimpl->listener) {
+		runPooledListener();
+		return;
+	}
+
 	while (pimpl->active) {
 		if (recvString(sourceId, nmeaStr)) {
-			pimpl->listener->onStringAvailable(sourceId, nmeaStr);
+			deliver(sourceId, nmeaStr, conflated);
+		} else if (conflated) {
+			lock_guard<mutex> lock(pimpl->conflationMutex);
+			pimpl->conflationTimeout = true;
+			pimpl->conflationCondition.notify_one();
+		} else if (pimpl->listener) {
+			pimpl->listener->onTimeout();
+		}
+	}
+
+}
+
+void NmeaMulticastUdp::deliver(const std::string& sourceId,
+		const std::string& nmea, bool conflated) {
+	if (pimpl->latestValueCache) {
+		pimpl->latestValueCache->update(sourceId, nmea);
+	}
+	if (conflated) {
+		conflate(sourceId, nmea);
+	} else if (pimpl->listener) {
+		auto start = std::chrono::steady_clock::now();
+		pimpl->listener->onStringAvailable(sourceId, nmea);
+		recordDelivery(start);
+	}
+}
+
+void NmeaMulticastUdp::recordReceive(int len, bool valid) {
+	if (!pimpl->statistics) {
+		return;
+	}
+	if (len > 0) {
+		pimpl->statistics->recordDatagram(pimpl->transmissionGroup, len, valid);
+	}
+	// Poll the kernel counter on timeouts and every few datagrams, it costs a system call.
+	if (len <= 0 || ++pimpl->statisticsDatagrams == kernelDropsInterval) {
+		pimpl->statisticsDatagrams = 0;
+		int64_t drops = pimpl->multicast->dropCount();
+		if (drops >= 0) {
+			pimpl->statistics->recordKernelDrops(pimpl->transmissionGroup,
+					drops);
+		}
+	}
+}
+
+void NmeaMulticastUdp::recordDelivery(std::chrono::steady_clock::time_point start) {
+	if (pimpl->statistics) {
+		pimpl->statistics->recordDelivery(pimpl->transmissionGroup,
+				std::chrono::steady_clock::now() - start);
+	}
+}
+
+void NmeaMulticastUdp::runGroupListener() {
+	NmeaGroupAssembler& assembler = *pimpl->groupAssembler;
+	std::string sourceId;
+	std::string nmeaStr;
+
+	// Incomplete groups are dropped at most half a timeout late, also under steady traffic.
+	auto expireInterval = std::chrono::milliseconds(
+			std::max(pimpl->groupTimeout / 2, 1));
+	auto nextExpire = std::chrono::steady_clock::now() + expireInterval;
+
+	while (pimpl->active) {
+		const char* data = nullptr;
+		int len = pimpl->multicast->receive(data);
+
+		bool received = false;
+		if (len > 0) {
+			NmeaDatagramReader reader(data, len);
+			NmeaDatagramLine line;
+			while (reader.next(line)) {
+				received = true;
+				if (pimpl->statistics) {
+					pimpl->statistics->recordSentence(pimpl->transmissionGroup,
+							line.sourceId, line.sourceIdSize,
+							line.sentenceSize);
+				}
+				if (line.groupSize == 0) {
+					sourceId.assign(line.sourceId, line.sourceIdSize);
+					nmeaStr.assign(line.sentence, line.sentenceSize);
+					deliver(sourceId, nmeaStr, false);
+					continue;
+				}
+
+				if (pimpl->latestValueCache) {
+					sourceId.assign(line.sourceId, line.sourceIdSize);
+					nmeaStr.assign(line.sentence, line.sentenceSize);
+					pimpl->latestValueCache->update(sourceId, nmeaStr);
+				}
+
+				const char* block;
+				std::size_t size;
+				std::size_t lines;
+				if (assembler.add(line, block, size, lines) && pimpl->listener) {
+					sourceId.assign(line.sourceId, line.sourceIdSize);
+					auto start = std::chrono::steady_clock::now();
+					pimpl->listener->onGroupAvailable(sourceId, block, size,
+							lines);
+					recordDelivery(start);
+				}
+			}
+		}
+		recordReceive(len, received);
+
+		auto now = std::chrono::steady_clock::now();
+		if (now >= nextExpire) {
+			assembler.expire();
+			nextExpire = now + expireInterval;
+		}
+		if (!received && pimpl->listener) {
+			pimpl->listener->onTimeout();
+		}
+		uint64_t dropped = assembler.droppedCount();
+		if (pimpl->statistics && dropped != pimpl->groupDropped) {
+			pimpl->statistics->recordDrops(pimpl->transmissionGroup,
+					dropped - pimpl->groupDropped);
+		}
+		pimpl->groupDropped = dropped;
+	}
+
+}
+
+void NmeaMulticastUdp::dropPooled() {
+	++pimpl->poolDropped;
+	if (pimpl->statistics) {
+		pimpl->statistics->recordDrops(pimpl->transmissionGroup, 1);
+	}
+}
+
+void NmeaMulticastUdp::runPooledListener() {
+	NmeaBufferPool& pool = *pimpl->bufferPool;
+	std::string sourceId;
+	std::string nmeaStr;
+	NmeaBuffer buffer;
+
+	while (pimpl->active) {
+		// Only ask the pool when it has a free buffer, an empty acquire() counts as exhaustion.
+		if (!buffer && pool.available() > 0) {
+			buffer = pool.acquire();
+		}
+
+		int len;
+		if (!buffer) {
+			// Pool exhausted, drain the socket and keep the datagram only if a buffer was released meanwhile.
+			const char* data;
+			len = pimpl->multicast->receive(data);
+			if (len > 0 && !(buffer = pool.acquire())) {
+				dropPooled();
+				continue;
+			}
+			if (len > 0 && static_cast<std::size_t>(len) <= buffer.capacity()) {
+				memcpy(buffer.data(), data, len);
+			}
 		} else {
+			// Straight into the pool with select, one copy from the kernel owned buffer with io_uring.
+			len = pimpl->multicast->recv(buffer.data(), buffer.capacity());
+		}
+
+		if (len <= 0) {
+			recordReceive(len, false);
 			pimpl->listener->onTimeout();
+			continue;
+		}
+		if (static_cast<std::size_t>(len) > buffer.capacity()) {
+			// Only from receive(), recv() already drops what does not fit. Keep the buffer for the next one.
+			dropPooled();
+			continue;
+		}
+
+		NmeaDatagramReader reader(buffer.data(), len);
+		recordReceive(len, reader.isValid());
+		if (!reader.isValid()) {
+			continue;
+		}
+		if (pimpl->latestValueCache || pimpl->statistics) {
+			NmeaDatagramLine line;
+			while (reader.next(line)) {
+				if (pimpl->statistics) {
+					pimpl->statistics->recordSentence(pimpl->transmissionGroup,
+							line.sourceId, line.sourceIdSize,
+							line.sentenceSize);
+				}
+				if (pimpl->latestValueCache) {
+					sourceId.assign(line.sourceId, line.sourceIdSize);
+					nmeaStr.assign(line.sentence, line.sentenceSize);
+					pimpl->latestValueCache->update(sourceId, nmeaStr);
+				}
+			}
 		}
+
+		buffer.resize(len);
+		auto start = std::chrono::steady_clock::now();
+		pimpl->listener->onDatagramAvailable(std::move(buffer));
+		recordDelivery(start);
+	}
+
+}
+
+void NmeaMulticastUdp::conflate(const std::string& sourceId,
+		const std::string& nmea) {
+	// Key is source Id followed by talker and formatter, short enough to avoid allocations.
+	std::string& key = pimpl->conflationKey;
+	key.assign(sourceId);
+	if (nmea.size() > nmeaAddressSize) {
+		key.append(nmea, 1, nmeaAddressSize);
 	}
 
+	lock_guard<mutex> lock(pimpl->conflationMutex);
+
+	std::size_t index;
+	auto it = pimpl->conflationIndex.find(key);
+	if (it != pimpl->conflationIndex.end()) {
+		index = it->second;
+	} else if (pimpl->conflationEntries.size() < pimpl->conflationMaxKeys) {
+		index = pimpl->conflationEntries.size();
+		pimpl->conflationEntries.push_back(ConflatedEntry { sourceId, nmea,
+				false });
+		pimpl->conflationIndex[key] = index;
+	} else {
+		++pimpl->conflationOverflows;
+		if (pimpl->statistics) {
+			pimpl->statistics->recordDrops(pimpl->transmissionGroup, 1);
+		}
+		return;
+	}
+
+	ConflatedEntry& entry = pimpl->conflationEntries[index];
+	if (entry.pending) {
+		++pimpl->conflated;
+	} else {
+		entry.pending = true;
+		pimpl->conflationPending.push_back(index);
+		pimpl->conflationCondition.notify_one();
+	}
+	// Assign reuses the string capacity of the slot.
+	entry.sourceId.assign(sourceId);
+	entry.nmea.assign(nmea);
+}
+
+void NmeaMulticastUdp::runDispatcher() {
+	std::vector<std::size_t> cycle;
+	cycle.reserve(pimpl->conflationMaxKeys);
+	std::string sourceId;
+	std::string nmeaStr;
+
+	while (pimpl->active) {
+		bool timeout;
+		{
+			unique_lock<mutex> lock(pimpl->conflationMutex);
+			while (pimpl->active && pimpl->conflationPending.empty()
+					&& !pimpl->conflationTimeout) {
+				pimpl->conflationCondition.wait(lock);
+			}
+			cycle.swap(pimpl->conflationPending);
+			timeout = pimpl->conflationTimeout;
+			pimpl->conflationTimeout = false;
+		}
+
+		for (auto index : cycle) {
+			{
+				lock_guard<mutex> lock(pimpl->conflationMutex);
+				ConflatedEntry& entry = pimpl->conflationEntries[index];
+				sourceId.assign(entry.sourceId);
+				nmeaStr.assign(entry.nmea);
+				entry.pending = false;
+			}
+			auto start = std::chrono::steady_clock::now();
+			pimpl->listener->onStringAvailable(sourceId, nmeaStr);
+			recordDelivery(start);
+		}
+		cycle.clear();
+
+		if (timeout) {
+			pimpl->listener->onTimeout();
+		}
+	}
+
+}
+
+std::string NmeaMulticastUdp::transmissionGroupAddress(
+		NmeaTrasmissionGroupEnum transmissionGroup) {
+	return NmeaTrasmissionGroupMap[transmissionGroup].first;
+}
+
+int NmeaMulticastUdp::transmissionGroupPort(
+		NmeaTrasmissionGroupEnum transmissionGroup) {
+	return NmeaTrasmissionGroupMap[transmissionGroup].second;
 }
 
 int16_t NmeaMulticastUdp::calculateNmeaChecksum(const std::string& nmeaStr) {
@@ -0,0 +1,396 @@
+/**
+ *	@file NmeaPassiveCapture.cpp
+ *	@brief Implementation of the NmeaPassiveCapture class
+ */
+
+#include "NmeaPassiveCapture.h"
+
+#include "NmeaPassiveCaptureListener.h"
+
+#include "NmeaMulticastUdp.h"
+
+#include "NmeaDatagram.h"
+
+#include <arpa/inet.h>
+#include <linux/filter.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#include <boost/thread.hpp>
+#include <boost/log/trivial.hpp>
+
+#ifdef NM_DEBUG
+#define LOG_MESSAGE(lvl) BOOST_LOG_TRIVIAL(lvl)
+#else
+#define LOG_MESSAGE(lvl) if (false) BOOST_LOG_TRIVIAL(lvl)
+#endif
+
+using namespace boost;
+
+const unsigned frameSize = 2048;
+const unsigned blockRetireTimeout = 8;
+const unsigned snapLength = 65535;
+
+struct CaptureGroup {
+	NmeaTrasmissionGroupEnum group;
+	uint32_t address;
+	uint16_t port;
+};
+
+class NmeaPassiveCapture::impl {
+public:
+	std::string interfaceName;
+	std::size_t blockSize;
+	unsigned blockCount;
+	int timeout;
+
+	int fd;
+	bool active;
+
+	char* ring;
+	std::size_t ringSize;
+	unsigned currentBlock;
+
+	std::vector<CaptureGroup> groups;
+	uint32_t minAddress;
+	uint32_t maxAddress;
+	uint16_t minPort;
+	uint16_t maxPort;
+
+	std::atomic<uint64_t> captured;
+	std::atomic<uint64_t> dropped;
+
+	std::string sourceId;
+	std::string nmea;
+
+	thread listenerThread;
+	std::shared_ptr<NmeaPassiveCaptureListener> listener;
+
+	void updateStatistics() {
+		tpacket_stats_v3 stats;
+		socklen_t len = sizeof(stats);
+		// Reading the statistics resets the kernel counters.
+		if (getsockopt(fd, SOL_PACKET, PACKET_STATISTICS, &stats, &len) == 0) {
+			dropped += stats.tp_drops;
+		}
+	}
+};
+
+NmeaPassiveCapture::NmeaPassiveCapture(const std::string& interfaceName,
+		std::size_t blockSize, unsigned blockCount, int timeout) :
+		pimpl { new impl } {
+	pimpl->interfaceName = interfaceName;
+	pimpl->blockSize = blockSize;
+	pimpl->blockCount = blockCount;
+	pimpl->timeout = timeout;
+	pimpl->fd = -1;
+	pimpl->active = false;
+	pimpl->ring = nullptr;
+	pimpl->ringSize = 0;
+	pimpl->currentBlock = 0;
+	pimpl->captured = 0;
+	pimpl->dropped = 0;
+
+	pimpl->minAddress = UINT32_MAX;
+	pimpl->maxAddress = 0;
+	pimpl->minPort = UINT16_MAX;
+	pimpl->maxPort = 0;
+	for (int g = NmeaTransmissionGroup_MISC; g <= NmeaTransmissionGroup_USR8;
+			++g) {
+		NmeaTrasmissionGroupEnum group = static_cast<NmeaTrasmissionGroupEnum>(g);
+		in_addr address;
+		inet_aton(NmeaMulticastUdp::transmissionGroupAddress(group).c_str(),
+				&address);
+		CaptureGroup entry { group, ntohl(address.s_addr),
+				static_cast<uint16_t>(NmeaMulticastUdp::transmissionGroupPort(
+						group)) };
+		pimpl->groups.push_back(entry);
+		pimpl->minAddress = std::min(pimpl->minAddress, entry.address);
+		pimpl->maxAddress = std::max(pimpl->maxAddress, entry.address);
+		pimpl->minPort = std::min(pimpl->minPort, entry.port);
+		pimpl->maxPort = std::max(pimpl->maxPort, entry.port);
+	}
+
+	LOG_MESSAGE(info)<< "NmeaPassiveCapture Interface = " << interfaceName;
+}
+
+NmeaPassiveCapture::~NmeaPassiveCapture() {
+	close();
+}
+
+bool NmeaPassiveCapture::open() {
+	bool ret = false;
+
+	LOG_MESSAGE(trace)<< "NmeaPassiveCapture open()";
+
+	if (pimpl->fd >= 0) {
+		LOG_MESSAGE(error) << "Socket ya abierto";
+		return false;
+	}
+
+	unsigned ifindex = if_nametoindex(pimpl->interfaceName.c_str());
+	if (ifindex == 0) {
+		LOG_MESSAGE(error)<< "Interfaz no encontrada '" << pimpl->interfaceName << "'";
+		return false;
+	}
+
+	// Protocol 0 until bind so no frame is queued before the filter is attached.
+	pimpl->fd = socket(AF_PACKET, SOCK_DGRAM, 0);
+	if (pimpl->fd < 0) {
+		LOG_MESSAGE(error)<< "No se pudo crear socket '" << strerror(errno) << "'";
+		return false;
+	}
+
+	// Offsets are relative to the IP header, SOCK_DGRAM strips the link layer. Fragments are dropped, both the
+	// ones with an offset and first fragments with the more fragments flag.
+	const unsigned drop = 17;
+	sock_filter code[] = {
+		/*  0 */ BPF_STMT(BPF_LD | BPF_W | BPF_ABS, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_PKTTYPE)),
+		/*  1 */ BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, PACKET_OUTGOING, drop - 2, 0),
+		/*  2 */ BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 0),
+		/*  3 */ BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0xf0),
+		/*  4 */ BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x40, 0, drop - 5),
+		/*  5 */ BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 9),
+		/*  6 */ BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_UDP, 0, drop - 7),
+		/*  7 */ BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 6),
+		/*  8 */ BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x3fff, drop - 9, 0),
+		/*  9 */ BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 16),
+		/* 10 */ BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, pimpl->minAddress, 0, drop - 11),
+		/* 11 */ BPF_JUMP(BPF_JMP | BPF_JGT | BPF_K, pimpl->maxAddress, drop - 12, 0),
+		/* 12 */ BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 0),
+		/* 13 */ BPF_STMT(BPF_LD | BPF_H | BPF_IND, 2),
+		/* 14 */ BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, pimpl->minPort, 0, drop - 15),
+		/* 15 */ BPF_JUMP(BPF_JMP | BPF_JGT | BPF_K, pimpl->maxPort, drop - 16, 0),
+		/* 16 */ BPF_STMT(BPF_RET | BPF_K, snapLength),
+		/* 17 */ BPF_STMT(BPF_RET | BPF_K, 0)
+	};
+	sock_fprog filter;
+	filter.len = sizeof(code) / sizeof(code[0]);
+	filter.filter = code;
+
+	int version = TPACKET_V3;
+
+	tpacket_req3 req;
+	memset(&req, 0, sizeof(req));
+	req.tp_block_size = pimpl->blockSize;
+	req.tp_block_nr = pimpl->blockCount;
+	req.tp_frame_size = frameSize;
+	req.tp_frame_nr = (pimpl->blockSize * pimpl->blockCount) / frameSize;
+	req.tp_retire_blk_tov = blockRetireTimeout;
+
+	sockaddr_ll ll;
+	memset(&ll, 0, sizeof(ll));
+	ll.sll_family = AF_PACKET;
+	ll.sll_protocol = htons(ETH_P_IP);
+	ll.sll_ifindex = ifindex;
+
+	if (setsockopt(pimpl->fd, SOL_SOCKET, SO_ATTACH_FILTER, &filter,
+			sizeof(filter)) != 0) {
+		LOG_MESSAGE(error)<< "No se pudo instalar el filtro '" << strerror(errno) << "'";
+	} else if (setsockopt(pimpl->fd, SOL_PACKET, PACKET_VERSION, &version,
+			sizeof(version)) != 0) {
+		LOG_MESSAGE(error)<< "TPACKET_V3 no soportado '" << strerror(errno) << "'";
+	} else if (setsockopt(pimpl->fd, SOL_PACKET, PACKET_RX_RING, &req,
+			sizeof(req)) != 0) {
+		LOG_MESSAGE(error)<< "No se pudo crear PACKET_RX_RING '" << strerror(errno) << "'";
+	} else {
+		pimpl->ringSize = pimpl->blockSize * pimpl->blockCount;
+		void* ring = mmap(nullptr, pimpl->ringSize, PROT_READ | PROT_WRITE,
+		MAP_SHARED, pimpl->fd, 0);
+		if (ring == MAP_FAILED) {
+			LOG_MESSAGE(error)<< "No se pudo mapear el ring '" << strerror(errno) << "'";
+		} else {
+			pimpl->ring = static_cast<char*>(ring);
+			pimpl->currentBlock = 0;
+			if (::bind(pimpl->fd, reinterpret_cast<sockaddr*>(&ll), sizeof(ll))
+					!= 0) {
+				LOG_MESSAGE(error)<< "Error al hacer bind '" << strerror(errno) << "'";
+			} else {
+				pimpl->captured = 0;
+				pimpl->dropped = 0;
+				ret = true;
+			}
+		}
+	}
+
+	if (!ret) {
+		LOG_MESSAGE(error)<< "Error al abrir socket. Cerrando";
+		if (pimpl->ring != nullptr) {
+			munmap(pimpl->ring, pimpl->ringSize);
+			pimpl->ring = nullptr;
+		}
+		::close(pimpl->fd);
+		pimpl->fd = -1;
+	}
+
+	return ret;
+}
+
+bool NmeaPassiveCapture::close() {
+	bool ret = false;
+
+	LOG_MESSAGE(trace)<< "NmeaPassiveCapture close()";
+
+	if (isOpen()) {
+		stopListening();
+		munmap(pimpl->ring, pimpl->ringSize);
+		pimpl->ring = nullptr;
+		::close(pimpl->fd);
+		pimpl->fd = -1;
+		ret = true;
+		LOG_MESSAGE(debug)<< "Socket cerrado";
+	}
+
+	return ret;
+}
+
+bool NmeaPassiveCapture::isOpen() {
+	return (pimpl->fd >= 0);
+}
+
+void NmeaPassiveCapture::setListener(
+		std::shared_ptr<NmeaPassiveCaptureListener> listener) {
+	pimpl->listener = listener;
+}
+
+void NmeaPassiveCapture::unsetListener() {
+	pimpl->listener.reset();
+}
+
+bool NmeaPassiveCapture::startListening() {
+	LOG_MESSAGE(trace)<< "NmeaPassiveCapture::startListening >>>>";
+	bool ret = false;
+
+	if (!pimpl->active && pimpl->listener) {
+		if (isOpen() || open()) {
+			pimpl->active = true;
+			ret = true;
+
+			thread t(bind(&NmeaPassiveCapture::runListener, this));
+			pimpl->listenerThread.swap(t);
+			LOG_MESSAGE(debug) << "NmeaPassiveCapture::startListening se inicia hilo";
+		}
+	}
+	LOG_MESSAGE(trace) << "NmeaPassiveCapture::startListening <<<<";
+	return ret;
+}
+
+void NmeaPassiveCapture::stopListening() {
+	LOG_MESSAGE(trace)<< "NmeaPassiveCapture::stopListening >>>>";
+	if (pimpl->active) {
+		pimpl->active = false;
+		pimpl->listenerThread.join();
+		LOG_MESSAGE(debug) << "NmeaPassiveCapture::stopListening: se liberó hilo";
+	}
+	LOG_MESSAGE(trace) << "NmeaPassiveCapture::stopListening <<<<";
+}
+
+uint64_t NmeaPassiveCapture::capturedCount() {
+	return pimpl->captured;
+}
+
+uint64_t NmeaPassiveCapture::droppedCount() {
+	if (isOpen()) {
+		pimpl->updateStatistics();
+	}
+	return pimpl->dropped;
+}
+
+void NmeaPassiveCapture::runListener() {
+	pollfd pfd;
+	pfd.fd = pimpl->fd;
+	pfd.events = POLLIN | POLLERR;
+
+	while (pimpl->active) {
+		tpacket_block_desc* desc = reinterpret_cast<tpacket_block_desc*>(pimpl->ring
+				+ pimpl->currentBlock * pimpl->blockSize);
+
+		if (!(__atomic_load_n(&desc->hdr.bh1.block_status, __ATOMIC_ACQUIRE)
+				& TP_STATUS_USER)) {
+			pfd.revents = 0;
+			int ret = poll(&pfd, 1, pimpl->timeout);
+			if (ret == 0) {
+				pimpl->updateStatistics();
+				pimpl->listener->onTimeout();
+			} else if (ret < 0 && errno != EINTR) {
+				pimpl->listener->onConnectionError();
+			}
+			continue;
+		}
+
+		processBlock(desc);
+
+		// Give the block back to the kernel.
+		__atomic_store_n(&desc->hdr.bh1.block_status, TP_STATUS_KERNEL,
+				__ATOMIC_RELEASE);
+		pimpl->currentBlock = (pimpl->currentBlock + 1) % pimpl->blockCount;
+	}
+}
+
+void NmeaPassiveCapture::processBlock(void* block) {
+	tpacket_block_desc* desc = static_cast<tpacket_block_desc*>(block);
+	const char* frame = static_cast<const char*>(block)
+			+ desc->hdr.bh1.offset_to_first_pkt;
+
+	for (uint32_t i = 0; i < desc->hdr.bh1.num_pkts; ++i) {
+		const tpacket3_hdr* hdr = reinterpret_cast<const tpacket3_hdr*>(frame);
+		processFrame(frame + hdr->tp_net, hdr->tp_snaplen);
+		frame += hdr->tp_next_offset;
+	}
+}
+
+void NmeaPassiveCapture::processFrame(const char* frame, std::size_t size) {
+	const unsigned char* ip = reinterpret_cast<const unsigned char*>(frame);
+	if (size < 20) {
+		return;
+	}
+	std::size_t ipHeaderSize = (ip[0] & 0x0f) * 4;
+	if (size < ipHeaderSize + 8) {
+		return;
+	}
+
+	uint32_t address = (ip[16] << 24) | (ip[17] << 16) | (ip[18] << 8) | ip[19];
+	const unsigned char* udp = ip + ipHeaderSize;
+	uint16_t port = (udp[2] << 8) | udp[3];
+	std::size_t udpSize = (udp[4] << 8) | udp[5];
+
+	const CaptureGroup* group = nullptr;
+	for (const auto& entry : pimpl->groups) {
+		if (entry.address == address && entry.port == port) {
+			group = &entry;
+			break;
+		}
+	}
+	if (group == nullptr || udpSize < 8) {
+		return;
+	}
+
+	std::size_t payloadSize = std::min(udpSize - 8, size - ipHeaderSize - 8);
+	NmeaDatagramReader reader(reinterpret_cast<const char*>(udp + 8),
+			payloadSize);
+	if (!reader.isValid()) {
+		return;
+	}
+	++pimpl->captured;
+
+	// Parsing reads the mapped frame, each sentence is then copied once into strings reused between calls.
+	NmeaDatagramLine line;
+	while (reader.next(line)) {
+		pimpl->sourceId.assign(line.sourceId, line.sourceIdSize);
+		pimpl->nmea.assign(line.sentence, line.sentenceSize);
+		pimpl->listener->onStringAvailable(group->group, pimpl->sourceId,
+				pimpl->nmea);
+	}
+}
@@ -0,0 +1,343 @@
+/**
+ *	@file NmeaRelay.cpp
+ *	@brief Implementation of the NmeaRelay class
+ */
+
+#include "NmeaRelay.h"
+
+#include "NmeaDatagram.h"
+
+#include "MulticastUdp.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <boost/thread.hpp>
+#include <boost/log/trivial.hpp>
+
+#ifdef NM_DEBUG
+#define LOG_MESSAGE(lvl) BOOST_LOG_TRIVIAL(lvl)
+#else
+#define LOG_MESSAGE(lvl) if (false) BOOST_LOG_TRIVIAL(lvl)
+#endif
+
+using namespace boost;
+
+const int relayTimeout = 1000;
+const std::size_t relayBufferSize = 4096;
+const std::size_t nmeaAddressSize = 5;
+
+// Room in front of the received datagram for the largest header and TAG block the relay writes.
+const std::size_t relayHeadroom = 64;
+
+/*
+ * Target group socket. The "n:" counter belongs to each source Id emitted on the group, whichever rule or
+ * receiving thread emits it, so the counters are shared and locked.
+ */
+struct RelayTarget {
+	std::unique_ptr<MulticastUdp> socket;
+	std::mutex counterMutex;
+	std::unordered_map<std::string, unsigned> counters;
+
+	unsigned nextCounter(const std::string& sourceId) {
+		std::lock_guard<std::mutex> lock(counterMutex);
+		unsigned& counter = counters[sourceId];
+		if (counter == 0 || counter == 1000) {
+			counter = 1;
+		}
+		return counter++;
+	}
+};
+
+struct RelayRuleState {
+	NmeaRelayRule rule;
+	std::chrono::steady_clock::duration interval;
+	std::chrono::steady_clock::time_point last;
+	RelayTarget* target;
+};
+
+struct NmeaRelay::Route {
+	NmeaTrasmissionGroupEnum group;
+	std::unique_ptr<MulticastUdp> socket;
+	std::vector<RelayRuleState> rules;
+	std::vector<RelayRuleState*> matched;
+	std::vector<char> buffer;
+	std::string emittedId;
+	thread listenerThread;
+};
+
+class NmeaRelay::impl {
+public:
+	std::atomic<bool> active;
+
+	std::vector<NmeaRelayRule> rules;
+	std::vector<std::unique_ptr<Route>> routes;
+	std::unordered_map<int, std::unique_ptr<RelayTarget>> targets;
+
+	std::atomic<uint64_t> forwarded;
+	std::atomic<uint64_t> rateLimited;
+	std::atomic<uint64_t> dropped;
+};
+
+static std::unique_ptr<MulticastUdp> createSocket(
+		NmeaTrasmissionGroupEnum group) {
+	return std::unique_ptr<MulticastUdp>(
+			new MulticastUdp(std::string("0.0.0.0"),
+					NmeaMulticastUdp::transmissionGroupAddress(group),
+					NmeaMulticastUdp::transmissionGroupPort(group),
+					relayTimeout));
+}
+
+static bool matchAddress(const std::string& pattern, const char* sentence,
+		std::size_t sentenceSize) {
+	if (pattern.empty()) {
+		return true;
+	}
+	if (sentenceSize < 1 + nmeaAddressSize
+			|| (sentence[0] != '$' && sentence[0] != '!')) {
+		return false;
+	}
+	for (std::size_t i = 0; i < pattern.size(); ++i) {
+		if (pattern[i] != '?' && pattern[i] != sentence[1 + i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool matchSourceId(const std::string& sourceId, const char* id,
+		std::size_t idSize) {
+	return sourceId.empty()
+			|| (sourceId.size() == idSize
+					&& memcmp(sourceId.data(), id, idSize) == 0);
+}
+
+NmeaRelay::NmeaRelay() :
+		pimpl { new impl } {
+	pimpl->active = false;
+	pimpl->forwarded = 0;
+	pimpl->rateLimited = 0;
+	pimpl->dropped = 0;
+}
+
+NmeaRelay::~NmeaRelay() {
+	stop();
+}
+
+bool NmeaRelay::addRule(const NmeaRelayRule& rule) {
+	if (pimpl->active || rule.sourceGroup == rule.targetGroup
+			|| rule.address.size() > nmeaAddressSize
+			|| rule.newSourceId.size() > NmeaRelayMaxSourceId
+			|| rule.maxRate < 0) {
+		LOG_MESSAGE(error)<< "Regla de reenvío no válida";
+		return false;
+	}
+
+	// Reject a rule that lets forwarded sentences come back to its source group.
+	std::vector<bool> reached(NmeaTransmissionGroup_USR8 + 1, false);
+	std::vector<NmeaTrasmissionGroupEnum> pending(1, rule.targetGroup);
+	reached[rule.targetGroup] = true;
+	while (!pending.empty()) {
+		NmeaTrasmissionGroupEnum group = pending.back();
+		pending.pop_back();
+		if (group == rule.sourceGroup) {
+			LOG_MESSAGE(error)<< "Regla de reenvío cierra un ciclo entre grupos";
+			return false;
+		}
+		for (const auto& r : pimpl->rules) {
+			if (r.sourceGroup == group && !reached[r.targetGroup]) {
+				reached[r.targetGroup] = true;
+				pending.push_back(r.targetGroup);
+			}
+		}
+	}
+
+	pimpl->rules.push_back(rule);
+	return true;
+}
+
+void NmeaRelay::clearRules() {
+	if (!pimpl->active) {
+		pimpl->rules.clear();
+	}
+}
+
+bool NmeaRelay::start() {
+	LOG_MESSAGE(trace)<< "NmeaRelay::start >>>>";
+	if (pimpl->active || pimpl->rules.empty()) {
+		return false;
+	}
+
+	bool ret = true;
+	for (const auto& rule : pimpl->rules) {
+		auto& target = pimpl->targets[rule.targetGroup];
+		if (!target) {
+			target.reset(new RelayTarget);
+			target->socket = createSocket(rule.targetGroup);
+			ret = ret && target->socket->open();
+		}
+
+		Route* route = nullptr;
+		for (auto& r : pimpl->routes) {
+			if (r->group == rule.sourceGroup) {
+				route = r.get();
+			}
+		}
+		if (route == nullptr) {
+			pimpl->routes.emplace_back(new Route);
+			route = pimpl->routes.back().get();
+			route->group = rule.sourceGroup;
+			route->socket = createSocket(rule.sourceGroup);
+			route->buffer.resize(relayHeadroom + relayBufferSize + 2);
+			ret = ret && route->socket->open();
+		}
+
+		RelayRuleState state;
+		state.rule = rule;
+		state.interval = std::chrono::steady_clock::duration::zero();
+		if (rule.maxRate > 0) {
+			state.interval = std::chrono::duration_cast<
+					std::chrono::steady_clock::duration>(
+					std::chrono::duration<double>(1.0 / rule.maxRate));
+		}
+		state.last = std::chrono::steady_clock::time_point();
+		state.target = target.get();
+		route->rules.push_back(state);
+	}
+
+	if (!ret) {
+		LOG_MESSAGE(error)<< "NmeaRelay::start no se pudieron abrir los sockets";
+		pimpl->routes.clear();
+		pimpl->targets.clear();
+		return false;
+	}
+
+	pimpl->active = true;
+	for (auto& route : pimpl->routes) {
+		route->matched.reserve(route->rules.size());
+		thread t(bind(&NmeaRelay::runRoute, this, std::ref(*route)));
+		route->listenerThread.swap(t);
+	}
+	LOG_MESSAGE(debug)<< "NmeaRelay::start se inician " << pimpl->routes.size() << " hilos";
+	LOG_MESSAGE(trace)<< "NmeaRelay::start <<<<";
+	return true;
+}
+
+void NmeaRelay::stop() {
+	if (pimpl->active) {
+		pimpl->active = false;
+		for (auto& route : pimpl->routes) {
+			route->listenerThread.join();
+		}
+		pimpl->routes.clear();
+		pimpl->targets.clear();
+		LOG_MESSAGE(debug)<< "NmeaRelay::stop se liberaron hilos";
+	}
+}
+
+bool NmeaRelay::isRunning() {
+	return pimpl->active;
+}
+
+uint64_t NmeaRelay::forwardedCount() {
+	return pimpl->forwarded;
+}
+
+uint64_t NmeaRelay::rateLimitedCount() {
+	return pimpl->rateLimited;
+}
+
+uint64_t NmeaRelay::droppedCount() {
+	return pimpl->dropped;
+}
+
+void NmeaRelay::runRoute(Route& route) {
+	char* data = &route.buffer[relayHeadroom];
+
+	while (pimpl->active) {
+		int len = route.socket->recv(data, relayBufferSize);
+		if (len <= 0) {
+			continue;
+		}
+
+		NmeaDatagramReader reader(data, len);
+		NmeaDatagramLine line;
+		while (reader.next(line)) {
+			std::chrono::steady_clock::time_point now;
+			route.matched.clear();
+			for (auto& state : route.rules) {
+				if (!matchAddress(state.rule.address, line.sentence,
+						line.sentenceSize)
+						|| !matchSourceId(state.rule.sourceId, line.sourceId,
+								line.sourceIdSize)) {
+					continue;
+				}
+				if (state.interval != std::chrono::steady_clock::duration::zero()) {
+					if (now == std::chrono::steady_clock::time_point()) {
+						now = std::chrono::steady_clock::now();
+					}
+					if (now - state.last < state.interval) {
+						++pimpl->rateLimited;
+						continue;
+					}
+					state.last = now;
+				}
+				route.matched.push_back(&state);
+			}
+			if (route.matched.empty()) {
+				continue;
+			}
+
+			// The TAG block is about to be overwritten, keep the received source Id.
+			char sourceId[NmeaRelayMaxSourceId];
+			std::size_t sourceIdSize = std::min(line.sourceIdSize,
+					NmeaRelayMaxSourceId);
+			bool sourceIdFits = (line.sourceIdSize <= NmeaRelayMaxSourceId);
+			if (sourceIdSize > 0) {
+				memcpy(sourceId, line.sourceId, sourceIdSize);
+			}
+
+			// The datagram is in our buffer, the reader only hands out const pointers.
+			char* sentence = data + (line.sentence - data);
+			char* end = sentence + line.sentenceSize;
+			char terminator[2] = { end[0], end[1] };
+			end[0] = '\r';
+			end[1] = '\n';
+
+			for (auto state : route.matched) {
+				const char* id = state->rule.newSourceId.data();
+				std::size_t idSize = state->rule.newSourceId.size();
+				if (idSize == 0) {
+					if (!sourceIdFits) {
+						++pimpl->dropped;
+						continue;
+					}
+					id = sourceId;
+					idSize = sourceIdSize;
+				}
+
+				route.emittedId.assign(id, idSize);
+				unsigned counter = state->target->nextCounter(route.emittedId);
+
+				std::size_t prefix = NmeaDatagramHeaderSize
+						+ NmeaDatagramWriter::tagBlockSize(idSize, counter);
+				char* start = sentence - prefix;
+				NmeaDatagramWriter writer(start, prefix);
+				writer.writeTagBlock(id, idSize, counter);
+
+				if (state->target->socket->send(start, end + 2 - start) > 0) {
+					++pimpl->forwarded;
+				} else {
+					++pimpl->dropped;
+				}
+			}
+
+			// The next line may start right after the sentence.
+			end[0] = terminator[0];
+			end[1] = terminator[1];
+		}
+	}
+}
@@ -0,0 +1,217 @@
+/**
+ *	@file NmeaSentenceEncoder.cpp
+ *	@brief Implementation of the typed NMEA sentence encoders
+ */
+
+#include "NmeaSentenceEncoder.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+static const uint64_t powersOfTen[] = { 1ull, 10ull, 100ull, 1000ull, 10000ull,
+		100000ull, 1000000ull, 10000000ull, 100000000ull, 1000000000ull,
+		10000000000ull, 100000000000ull, 1000000000000ull, 10000000000000ull,
+		100000000000000ull, 1000000000000000ull };
+
+static const unsigned maxPower = sizeof(powersOfTen) / sizeof(powersOfTen[0])
+		- 1;
+
+/*
+ * Writes a sentence from left to right. Every character between '$' and '*' goes through put(), which
+ * accumulates the checksum, so no second pass over the sentence is needed.
+ */
+class SentenceCursor {
+public:
+	SentenceCursor(char* buffer, const char* talker, const char* formatter) :
+			start(buffer), p(buffer), checksum(0) {
+		*p++ = '$';
+		put(talker[0]);
+		put(talker[1]);
+		put(formatter[0]);
+		put(formatter[1]);
+		put(formatter[2]);
+	}
+
+	void put(char c) {
+		*p++ = c;
+		checksum ^= static_cast<unsigned char>(c);
+	}
+
+	// Unsigned integer, zero padded to at least width digits.
+	void integer(uint64_t value, unsigned width) {
+		char digits[20];
+		unsigned count = 0;
+		do {
+			digits[count++] = '0' + (value % 10);
+			value /= 10;
+		} while (value > 0);
+		while (count < width) {
+			digits[count++] = '0';
+		}
+		while (count > 0) {
+			put(digits[--count]);
+		}
+	}
+
+	// Fixed point number given in units of 10^-decimals.
+	void decimal(uint64_t units, unsigned decimals, unsigned width) {
+		integer(units / powersOfTen[decimals], width);
+		if (decimals > 0) {
+			put('.');
+			integer(units % powersOfTen[decimals], decimals);
+		}
+	}
+
+	// Signed number rounded to a fixed number of decimals. Null field if NaN or wider than maxDigits.
+	bool fixed(double value, unsigned decimals, unsigned maxDigits) {
+		double scaled = std::fabs(value) * powersOfTen[decimals];
+		if (!(scaled < powersOfTen[maxPower])) {
+			return false;
+		}
+		uint64_t units = static_cast<uint64_t>(std::llround(scaled));
+		if (units >= powersOfTen[maxDigits + decimals]) {
+			return false;
+		}
+		if (value < 0 && units != 0) {
+			put('-');
+		}
+		decimal(units, decimals, 1);
+		return true;
+	}
+
+	void heading(double value) {
+		if (!std::isfinite(value)) {
+			return;
+		}
+		double degrees = std::fmod(value, 360.0);
+		if (degrees < 0) {
+			degrees += 360.0;
+		}
+		uint64_t units = static_cast<uint64_t>(std::llround(degrees * 100));
+		if (units >= 36000) {
+			units -= 36000;
+		}
+		decimal(units, 2, 1);
+	}
+
+	// Degrees and minutes with five decimals followed by the hemisphere field.
+	void coordinate(double value, double limit, unsigned degreeDigits,
+			char positive, char negative) {
+		if (!(std::fabs(value) <= limit)) {
+			put(',');
+			return;
+		}
+		uint64_t units = static_cast<uint64_t>(std::llround(
+				std::fabs(value) * 6000000.0));
+		integer(units / 6000000, degreeDigits);
+		decimal(units % 6000000, 5, 2);
+		put(',');
+		put((value < 0 && units != 0) ? negative : positive);
+	}
+
+	void time(double seconds) {
+		if (!(seconds >= 0 && seconds < powersOfTen[9])) {
+			return;
+		}
+		uint64_t centiseconds = static_cast<uint64_t>(std::llround(
+				seconds * 100)) % 8640000;
+		integer(centiseconds / 360000, 2);
+		integer(centiseconds / 6000 % 60, 2);
+		decimal(centiseconds % 6000, 2, 2);
+	}
+
+	std::size_t finish() {
+		static const char hex[] = "0123456789ABCDEF";
+		*p++ = '*';
+		*p++ = hex[checksum >> 4];
+		*p++ = hex[checksum & 0x0f];
+		return p - start;
+	}
+
+private:
+	char* start;
+	char* p;
+	unsigned char checksum;
+};
+
+std::size_t nmeaEncode(char* buffer, std::size_t capacity, const char* talker,
+		const NmeaTrueHeading& sentence) {
+	if (capacity < NmeaEncodedSentenceMaxSize) {
+		return 0;
+	}
+	SentenceCursor cursor(buffer, talker, "HDT");
+	cursor.put(',');
+	cursor.heading(sentence.heading);
+	cursor.put(',');
+	cursor.put('T');
+	return cursor.finish();
+}
+
+std::size_t nmeaEncode(char* buffer, std::size_t capacity, const char* talker,
+		const NmeaTrueHeadingStatus& sentence) {
+	if (capacity < NmeaEncodedSentenceMaxSize || sentence.mode == '\0'
+			|| strchr("AEMSV", sentence.mode) == nullptr) {
+		return 0;
+	}
+	SentenceCursor cursor(buffer, talker, "THS");
+	cursor.put(',');
+	cursor.heading(sentence.heading);
+	cursor.put(',');
+	cursor.put(sentence.mode);
+	return cursor.finish();
+}
+
+std::size_t nmeaEncode(char* buffer, std::size_t capacity, const char* talker,
+		const NmeaRateOfTurn& sentence) {
+	if (capacity < NmeaEncodedSentenceMaxSize) {
+		return 0;
+	}
+	SentenceCursor cursor(buffer, talker, "ROT");
+	cursor.put(',');
+	bool rate = cursor.fixed(sentence.rate, 1, 4);
+	cursor.put(',');
+	cursor.put((sentence.valid && rate) ? 'A' : 'V');
+	return cursor.finish();
+}
+
+std::size_t nmeaEncode(char* buffer, std::size_t capacity, const char* talker,
+		const NmeaPosition& sentence) {
+	if (capacity < NmeaEncodedSentenceMaxSize) {
+		return 0;
+	}
+	SentenceCursor cursor(buffer, talker, "GGA");
+	cursor.put(',');
+	cursor.time(sentence.time);
+	cursor.put(',');
+	cursor.coordinate(sentence.latitude, 90.0, 2, 'N', 'S');
+	cursor.put(',');
+	cursor.coordinate(sentence.longitude, 180.0, 3, 'E', 'W');
+	cursor.put(',');
+	if (sentence.quality <= 9) {
+		cursor.integer(sentence.quality, 1);
+	}
+	cursor.put(',');
+	if (sentence.satellites <= 99) {
+		cursor.integer(sentence.satellites, 2);
+	}
+	cursor.put(',');
+	cursor.fixed(sentence.hdop, 1, 3);
+	cursor.put(',');
+	cursor.fixed(sentence.altitude, 1, 6);
+	cursor.put(',');
+	cursor.put('M');
+	cursor.put(',');
+	cursor.fixed(sentence.geoidSeparation, 1, 4);
+	cursor.put(',');
+	cursor.put('M');
+	cursor.put(',');
+	if (sentence.dgpsAge >= 0) {
+		cursor.fixed(sentence.dgpsAge, 1, 4);
+	}
+	cursor.put(',');
+	if (sentence.dgpsStation >= 0 && sentence.dgpsStation <= 1023) {
+		cursor.integer(sentence.dgpsStation, 4);
+	}
+	return cursor.finish();
+}
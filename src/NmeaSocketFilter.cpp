@@ -0,0 +1,91 @@
+/**
+ *	@file NmeaSocketFilter.cpp
+ *	@brief Implementation of the NMEA socket filter generator
+ */
+
+#include "NmeaSocketFilter.h"
+
+#include "NmeaDatagram.h"
+
+#include <linux/filter.h>
+
+// The program of a UDP socket sees the UDP header first.
+const uint32_t udpHeaderSize = 8;
+
+const uint32_t acceptDatagram = 0xffffffff;
+const uint32_t rejectDatagram = 0;
+
+static MulticastUdpFilterInstruction instruction(uint16_t code, uint32_t k,
+		uint8_t jt = 0, uint8_t jf = 0) {
+	MulticastUdpFilterInstruction i = { code, jt, jf, k };
+	return i;
+}
+
+bool nmeaSocketFilter(const std::vector<std::string>& formatters,
+		std::vector<MulticastUdpFilterInstruction>& program) {
+	for (const auto& formatter : formatters) {
+		if (formatter.size() != 3) {
+			return false;
+		}
+	}
+
+	const uint32_t payload = udpHeaderSize;
+	std::vector<MulticastUdpFilterInstruction> p;
+
+	// "UdPbC\0" header.
+	p.push_back(instruction(BPF_LD | BPF_W | BPF_ABS, payload));
+	p.push_back(instruction(BPF_JMP | BPF_JEQ | BPF_K, 0x55645062, 1, 0));
+	p.push_back(instruction(BPF_RET | BPF_K, rejectDatagram));
+	p.push_back(instruction(BPF_LD | BPF_H | BPF_ABS, payload + 4));
+	p.push_back(instruction(BPF_JMP | BPF_JEQ | BPF_K, 0x4300, 1, 0));
+	p.push_back(instruction(BPF_RET | BPF_K, rejectDatagram));
+
+	// X is left on the character preceding the sentence: the last header byte or the closing backslash.
+	std::vector<std::size_t> toCheck;
+	p.push_back(instruction(BPF_LD | BPF_B | BPF_ABS,
+			payload + NmeaDatagramHeaderSize));
+	p.push_back(instruction(BPF_JMP | BPF_JEQ | BPF_K, '\\', 2, 0));
+	p.push_back(instruction(BPF_LDX | BPF_W | BPF_IMM,
+			payload + NmeaDatagramHeaderSize - 1));
+	toCheck.push_back(p.size());
+	p.push_back(instruction(BPF_JMP | BPF_JA, 0));
+
+	p.push_back(instruction(BPF_LDX | BPF_W | BPF_IMM,
+			payload + NmeaDatagramHeaderSize + 1));
+	for (std::size_t i = 1; i < NmeaSocketFilterMaxTagBlock; ++i) {
+		p.push_back(instruction(BPF_LD | BPF_B | BPF_IND, 0));
+		p.push_back(instruction(BPF_JMP | BPF_JEQ | BPF_K, '\\', 0, 1));
+		toCheck.push_back(p.size());
+		p.push_back(instruction(BPF_JMP | BPF_JA, 0));
+		p.push_back(instruction(BPF_MISC | BPF_TXA, 0));
+		p.push_back(instruction(BPF_ALU | BPF_ADD | BPF_K, 1));
+		p.push_back(instruction(BPF_MISC | BPF_TAX, 0));
+	}
+	p.push_back(instruction(BPF_RET | BPF_K, rejectDatagram));
+
+	// Formatter, after the start character and the talker. Reading it also rejects truncated sentences.
+	std::size_t check = p.size();
+	for (auto jump : toCheck) {
+		p[jump].k = check - jump - 1;
+	}
+	p.push_back(instruction(BPF_LD | BPF_W | BPF_IND, 4));
+	if (formatters.empty()) {
+		p.push_back(instruction(BPF_RET | BPF_K, acceptDatagram));
+	} else {
+		p.push_back(instruction(BPF_ALU | BPF_AND | BPF_K, 0xffffff00));
+		for (const auto& formatter : formatters) {
+			uint32_t key = (uint32_t(uint8_t(formatter[0])) << 24)
+					| (uint32_t(uint8_t(formatter[1])) << 16)
+					| (uint32_t(uint8_t(formatter[2])) << 8);
+			p.push_back(instruction(BPF_JMP | BPF_JEQ | BPF_K, key, 0, 1));
+			p.push_back(instruction(BPF_RET | BPF_K, acceptDatagram));
+		}
+		p.push_back(instruction(BPF_RET | BPF_K, rejectDatagram));
+	}
+
+	if (p.size() > BPF_MAXINSNS) {
+		return false;
+	}
+	program.swap(p);
+	return true;
+}
@@ -0,0 +1,36 @@
+/**
+*	@file NmeaSocketFilter.h
+*	@brief Header for the internal NMEA socket filter generator
+*/
+
+#ifndef SRC_NMEASOCKETFILTER_H_
+#define SRC_NMEASOCKETFILTER_H_
+
+#include <string>
+#include <vector>
+
+#include "MulticastUdp.h"
+
+/**
+ * @brief Maximum TAG block size scanned by the filter, in characters including both backslashes.
+ */
+const std::size_t NmeaSocketFilterMaxTagBlock = 80;
+
+/**
+ * @brief Build a classic BPF program accepting only "UdPbC" datagrams, used by NmeaMulticastUdp.
+ *
+ * The program checks the header, skips the TAG block of the first line if present and compares the three
+ * formatter characters of its sentence, e.g. "HDT" in "$HEHDT,...", against the subscribed set. Classic BPF
+ * has no backward jumps, so the search of the closing backslash is unrolled over NmeaSocketFilterMaxTagBlock
+ * characters. Datagrams with a longer TAG block, or shorter than the fields read, are rejected.
+ *
+ * @param [in] formatters Subscribed formatters, three characters each. Empty to check only the header.
+ * @param [out] program Generated program.
+ *
+ * @return True on success, false if a formatter is not three characters long or the program would exceed the
+ * kernel limit of BPF_MAXINSNS instructions.
+ */
+bool nmeaSocketFilter(const std::vector<std::string>& formatters,
+		std::vector<MulticastUdpFilterInstruction>& program);
+
+#endif /* SRC_NMEASOCKETFILTER_H_ */
@@ -0,0 +1,393 @@
+/**
+ *	@file NmeaStatistics.cpp
+ *	@brief Implementation of the NmeaStatistics and NmeaStatisticsReader classes
+ */
+
+#include "NmeaStatistics.h"
+
+#include "NmeaStatisticsSegment.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/log/trivial.hpp>
+
+#ifdef NM_DEBUG
+#define LOG_MESSAGE(lvl) BOOST_LOG_TRIVIAL(lvl)
+#else
+#define LOG_MESSAGE(lvl) if (false) BOOST_LOG_TRIVIAL(lvl)
+#endif
+
+// A publisher that died in the middle of a write leaves an odd sequence forever.
+const unsigned maxReadAttempts = 100000;
+
+static void beginWrite(std::atomic<uint32_t>& seq) {
+	seq.store(seq.load(std::memory_order_relaxed) + 1,
+			std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+}
+
+static void endWrite(std::atomic<uint32_t>& seq) {
+	seq.store(seq.load(std::memory_order_relaxed) + 1,
+			std::memory_order_release);
+}
+
+static void add(std::atomic<uint64_t>& counter, uint64_t value) {
+	// Single writer per section, see acquireGroup(), no need for a locked read-modify-write.
+	counter.store(counter.load(std::memory_order_relaxed) + value,
+			std::memory_order_relaxed);
+}
+
+static std::size_t latencyBucket(std::chrono::steady_clock::duration elapsed) {
+	auto us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+	std::size_t bucket = 0;
+	while (us > 0 && bucket < NmeaStatisticsLatencyBuckets - 1) {
+		us >>= 1;
+		++bucket;
+	}
+	return bucket;
+}
+
+NmeaStatistics::NmeaStatistics(const std::string& name) :
+		name(name), segment(nullptr) {
+	for (auto& writer : writers) {
+		writer.store(false, std::memory_order_relaxed);
+	}
+}
+
+NmeaStatistics::~NmeaStatistics() {
+	close();
+}
+
+bool NmeaStatistics::open() {
+	if (segment != nullptr) {
+		LOG_MESSAGE(error)<< "Segmento de estadísticas ya abierto";
+		return false;
+	}
+
+	int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	if (fd < 0 && errno == EEXIST && removeStale()) {
+		fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	}
+	if (fd < 0) {
+		LOG_MESSAGE(error)<< "No se pudo crear segmento '" << name << "': " << strerror(errno);
+		return false;
+	}
+
+	void* address = MAP_FAILED;
+	if (ftruncate(fd, sizeof(NmeaStatisticsSegment)) == 0) {
+		address = mmap(nullptr, sizeof(NmeaStatisticsSegment),
+				PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	::close(fd);
+
+	if (address == MAP_FAILED) {
+		LOG_MESSAGE(error)<< "No se pudo mapear segmento '" << name << "': " << strerror(errno);
+		shm_unlink(name.c_str());
+		return false;
+	}
+
+	segment = static_cast<NmeaStatisticsSegment*>(address);
+
+	// A new segment is zero filled, readers reject it until the magic is stored.
+	segment->version = NmeaStatisticsVersion;
+	segment->groupCount = NmeaStatisticsGroupCount;
+	segment->maxSources = NmeaStatisticsMaxSources;
+	segment->pid = getpid();
+	segment->magic.store(NmeaStatisticsMagic, std::memory_order_release);
+
+	LOG_MESSAGE(info)<< "Publicando estadísticas en '" << name << "'";
+	return true;
+}
+
+bool NmeaStatistics::removeStale() {
+	int fd = shm_open(name.c_str(), O_RDONLY, 0);
+	if (fd < 0) {
+		// Removed in the meantime.
+		return errno == ENOENT;
+	}
+
+	struct stat st;
+	void* address = MAP_FAILED;
+	if (fstat(fd, &st) == 0
+			&& st.st_size == static_cast<off_t>(sizeof(NmeaStatisticsSegment))) {
+		address = mmap(nullptr, sizeof(NmeaStatisticsSegment), PROT_READ,
+				MAP_SHARED, fd, 0);
+	}
+	::close(fd);
+
+	int pid = 0;
+	if (address != MAP_FAILED) {
+		const NmeaStatisticsSegment* s =
+				static_cast<const NmeaStatisticsSegment*>(address);
+		if (s->magic.load(std::memory_order_acquire) == NmeaStatisticsMagic) {
+			pid = s->pid;
+		}
+		munmap(address, sizeof(NmeaStatisticsSegment));
+	}
+
+	if (pid <= 0 || kill(pid, 0) == 0 || errno != ESRCH) {
+		LOG_MESSAGE(error)<< "Segmento '" << name << "' en uso por otro proceso";
+		return false;
+	}
+	LOG_MESSAGE(info)<< "Se reemplaza segmento '" << name << "' del proceso " << pid;
+	return shm_unlink(name.c_str()) == 0 || errno == ENOENT;
+}
+
+bool NmeaStatistics::close() {
+	if (segment == nullptr) {
+		return false;
+	}
+	munmap(segment, sizeof(NmeaStatisticsSegment));
+	segment = nullptr;
+	shm_unlink(name.c_str());
+	return true;
+}
+
+bool NmeaStatistics::isOpen() {
+	return segment != nullptr;
+}
+
+bool NmeaStatistics::acquireGroup(NmeaTrasmissionGroupEnum group) {
+	return !writers[group].exchange(true, std::memory_order_acquire);
+}
+
+void NmeaStatistics::releaseGroup(NmeaTrasmissionGroupEnum group) {
+	writers[group].store(false, std::memory_order_release);
+}
+
+void NmeaStatistics::recordDatagram(NmeaTrasmissionGroupEnum group,
+		std::size_t bytes, bool valid) {
+	if (segment == nullptr) {
+		return;
+	}
+	NmeaStatisticsSegmentGroup& g = segment->groups[group];
+	beginWrite(g.receiveSeq);
+	add(g.datagrams, 1);
+	add(g.bytes, bytes);
+	if (!valid) {
+		add(g.parseErrors, 1);
+	}
+	endWrite(g.receiveSeq);
+}
+
+void NmeaStatistics::recordSentence(NmeaTrasmissionGroupEnum group,
+		const char* sourceId, std::size_t sourceIdSize, std::size_t bytes) {
+	if (segment == nullptr) {
+		return;
+	}
+	uint64_t id[NmeaStatisticsSourceIdWords] = { };
+	memcpy(id, sourceId, std::min(sourceIdSize, NmeaStatisticsSourceIdSize));
+
+	NmeaStatisticsSegmentGroup& g = segment->groups[group];
+	uint32_t count = g.sourceCount.load(std::memory_order_relaxed);
+	NmeaStatisticsSegmentSource* source = nullptr;
+	for (uint32_t i = 0; i < count && source == nullptr; ++i) {
+		source = &g.sources[i];
+		for (std::size_t w = 0; w < NmeaStatisticsSourceIdWords; ++w) {
+			if (source->id[w].load(std::memory_order_relaxed) != id[w]) {
+				source = nullptr;
+				break;
+			}
+		}
+	}
+
+	beginWrite(g.receiveSeq);
+	add(g.sentences, 1);
+	if (source == nullptr && count < NmeaStatisticsMaxSources) {
+		source = &g.sources[count];
+		for (std::size_t w = 0; w < NmeaStatisticsSourceIdWords; ++w) {
+			source->id[w].store(id[w], std::memory_order_relaxed);
+		}
+		g.sourceCount.store(count + 1, std::memory_order_relaxed);
+	}
+	if (source != nullptr) {
+		add(source->sentences, 1);
+		add(source->bytes, bytes);
+	} else {
+		add(g.sourceOverflows, 1);
+	}
+	endWrite(g.receiveSeq);
+}
+
+void NmeaStatistics::recordDrops(NmeaTrasmissionGroupEnum group,
+		uint64_t count) {
+	if (segment == nullptr) {
+		return;
+	}
+	NmeaStatisticsSegmentGroup& g = segment->groups[group];
+	beginWrite(g.receiveSeq);
+	add(g.drops, count);
+	endWrite(g.receiveSeq);
+}
+
+void NmeaStatistics::recordKernelDrops(NmeaTrasmissionGroupEnum group,
+		uint64_t total) {
+	if (segment == nullptr) {
+		return;
+	}
+	NmeaStatisticsSegmentGroup& g = segment->groups[group];
+	beginWrite(g.receiveSeq);
+	g.kernelDrops.store(total, std::memory_order_relaxed);
+	endWrite(g.receiveSeq);
+}
+
+void NmeaStatistics::recordDelivery(NmeaTrasmissionGroupEnum group,
+		std::chrono::steady_clock::duration elapsed) {
+	if (segment == nullptr) {
+		return;
+	}
+	NmeaStatisticsSegmentGroup& g = segment->groups[group];
+	beginWrite(g.deliverySeq);
+	add(g.deliveries, 1);
+	add(g.latency[latencyBucket(elapsed)], 1);
+	endWrite(g.deliverySeq);
+}
+
+NmeaStatisticsReader::NmeaStatisticsReader(const std::string& name) :
+		name(name), segment(nullptr), device(0), inode(0) {
+}
+
+NmeaStatisticsReader::~NmeaStatisticsReader() {
+	close();
+}
+
+bool NmeaStatisticsReader::open() {
+	if (segment != nullptr) {
+		return false;
+	}
+
+	int fd = shm_open(name.c_str(), O_RDONLY, 0);
+	if (fd < 0) {
+		LOG_MESSAGE(error)<< "No existe segmento '" << name << "'";
+		return false;
+	}
+
+	struct stat st;
+	void* address = MAP_FAILED;
+	if (fstat(fd, &st) == 0
+			&& st.st_size == static_cast<off_t>(sizeof(NmeaStatisticsSegment))) {
+		address = mmap(nullptr, sizeof(NmeaStatisticsSegment), PROT_READ,
+				MAP_SHARED, fd, 0);
+		device = st.st_dev;
+		inode = st.st_ino;
+	}
+	::close(fd);
+
+	if (address == MAP_FAILED) {
+		LOG_MESSAGE(error)<< "Segmento '" << name << "' no válido";
+		return false;
+	}
+
+	const NmeaStatisticsSegment* s =
+			static_cast<const NmeaStatisticsSegment*>(address);
+	if (s->magic.load(std::memory_order_acquire) != NmeaStatisticsMagic
+			|| s->version != NmeaStatisticsVersion
+			|| s->groupCount != NmeaStatisticsGroupCount
+			|| s->maxSources != NmeaStatisticsMaxSources) {
+		LOG_MESSAGE(error)<< "Segmento '" << name << "' con formato desconocido";
+		munmap(address, sizeof(NmeaStatisticsSegment));
+		return false;
+	}
+
+	segment = s;
+	return true;
+}
+
+bool NmeaStatisticsReader::close() {
+	if (segment == nullptr) {
+		return false;
+	}
+	munmap(const_cast<NmeaStatisticsSegment*>(segment),
+			sizeof(NmeaStatisticsSegment));
+	segment = nullptr;
+	return true;
+}
+
+bool NmeaStatisticsReader::isOpen() {
+	return segment != nullptr;
+}
+
+int NmeaStatisticsReader::publisherPid() const {
+	return (segment != nullptr) ? segment->pid : 0;
+}
+
+bool NmeaStatisticsReader::isReplaced() const {
+	if (segment == nullptr) {
+		return true;
+	}
+	int fd = shm_open(name.c_str(), O_RDONLY, 0);
+	if (fd < 0) {
+		return true;
+	}
+	struct stat st;
+	bool replaced = fstat(fd, &st) != 0 || st.st_dev != device
+			|| st.st_ino != inode;
+	::close(fd);
+	return replaced;
+}
+
+bool NmeaStatisticsReader::snapshot(NmeaTrasmissionGroupEnum group,
+		NmeaGroupStatistics& statistics) const {
+	if (segment == nullptr) {
+		return false;
+	}
+	const NmeaStatisticsSegmentGroup& g = segment->groups[group];
+	uint32_t seqBefore;
+	uint32_t seqAfter;
+	unsigned attempts = 0;
+
+	do {
+		seqBefore = g.receiveSeq.load(std::memory_order_acquire);
+		if (seqBefore & 1) {
+			continue;
+		}
+		statistics.datagrams = g.datagrams.load(std::memory_order_relaxed);
+		statistics.bytes = g.bytes.load(std::memory_order_relaxed);
+		statistics.sentences = g.sentences.load(std::memory_order_relaxed);
+		statistics.parseErrors = g.parseErrors.load(std::memory_order_relaxed);
+		statistics.drops = g.drops.load(std::memory_order_relaxed);
+		statistics.kernelDrops = g.kernelDrops.load(std::memory_order_relaxed);
+		statistics.sourceOverflows = g.sourceOverflows.load(
+				std::memory_order_relaxed);
+		statistics.sourceCount = std::min<std::size_t>(
+				g.sourceCount.load(std::memory_order_relaxed),
+				NmeaStatisticsMaxSources);
+		for (std::size_t i = 0; i < statistics.sourceCount; ++i) {
+			const NmeaStatisticsSegmentSource& source = g.sources[i];
+			NmeaSourceStatistics& out = statistics.sources[i];
+			uint64_t id[NmeaStatisticsSourceIdWords];
+			for (std::size_t w = 0; w < NmeaStatisticsSourceIdWords; ++w) {
+				id[w] = source.id[w].load(std::memory_order_relaxed);
+			}
+			memcpy(out.sourceId, id, NmeaStatisticsSourceIdSize);
+			out.sourceId[NmeaStatisticsSourceIdSize] = '\0';
+			out.sentences = source.sentences.load(std::memory_order_relaxed);
+			out.bytes = source.bytes.load(std::memory_order_relaxed);
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		seqAfter = g.receiveSeq.load(std::memory_order_relaxed);
+	} while (((seqBefore & 1) || seqBefore != seqAfter)
+			&& ++attempts < maxReadAttempts);
+
+	do {
+		seqBefore = g.deliverySeq.load(std::memory_order_acquire);
+		if (seqBefore & 1) {
+			continue;
+		}
+		statistics.deliveries = g.deliveries.load(std::memory_order_relaxed);
+		for (std::size_t i = 0; i < NmeaStatisticsLatencyBuckets; ++i) {
+			statistics.latency[i] = g.latency[i].load(std::memory_order_relaxed);
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		seqAfter = g.deliverySeq.load(std::memory_order_relaxed);
+	} while (((seqBefore & 1) || seqBefore != seqAfter)
+			&& ++attempts < maxReadAttempts);
+
+	return attempts < maxReadAttempts;
+}
@@ -0,0 +1,58 @@
+/**
+*	@file NmeaStatisticsSegment.h
+*	@brief Layout of the shared memory segment used by NmeaStatistics
+*/
+
+#ifndef SRC_NMEASTATISTICSSEGMENT_H_
+#define SRC_NMEASTATISTICSSEGMENT_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include "NmeaStatistics.h"
+
+const uint32_t NmeaStatisticsMagic = 0x4e4d5354; // "NMST"
+const uint32_t NmeaStatisticsVersion = 1;
+const std::size_t NmeaStatisticsSourceIdWords = NmeaStatisticsSourceIdSize / sizeof(uint64_t);
+
+/*
+ * Every field shared with readers is an atomic word accessed with relaxed operations, the sequence locks
+ * order them. The layout only holds lock free atomics so it is valid across processes.
+ */
+
+struct NmeaStatisticsSegmentSource {
+	std::atomic<uint64_t> id[NmeaStatisticsSourceIdWords];
+	std::atomic<uint64_t> sentences;
+	std::atomic<uint64_t> bytes;
+};
+
+struct NmeaStatisticsSegmentGroup {
+	// Receive section, written by the receiving thread.
+	alignas(64) std::atomic<uint32_t> receiveSeq;
+	std::atomic<uint32_t> sourceCount;
+	std::atomic<uint64_t> datagrams;
+	std::atomic<uint64_t> bytes;
+	std::atomic<uint64_t> sentences;
+	std::atomic<uint64_t> parseErrors;
+	std::atomic<uint64_t> drops;
+	std::atomic<uint64_t> kernelDrops;
+	std::atomic<uint64_t> sourceOverflows;
+	NmeaStatisticsSegmentSource sources[NmeaStatisticsMaxSources];
+
+	// Delivery section, written by the thread calling the listener.
+	alignas(64) std::atomic<uint32_t> deliverySeq;
+	std::atomic<uint64_t> deliveries;
+	std::atomic<uint64_t> latency[NmeaStatisticsLatencyBuckets];
+};
+
+struct NmeaStatisticsSegment {
+	// Published last by the writer, readers reject the segment until it is set.
+	std::atomic<uint32_t> magic;
+	uint32_t version;
+	uint32_t groupCount;
+	uint32_t maxSources;
+	int32_t pid;
+	NmeaStatisticsSegmentGroup groups[NmeaStatisticsGroupCount];
+};
+
+#endif /* SRC_NMEASTATISTICSSEGMENT_H_ */
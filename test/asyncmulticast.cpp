@@ -0,0 +1,178 @@
+/*
+ * asyncmulticast.cpp
+ *
+ * NmeaAsyncMulticast over loopback with handlers carrying their own allocator and executor: a sentence sent
+ * and received, and a sentence too large to send. Every intermediate allocation must go through the handler
+ * allocator and every handler must run on the handler executor.
+ */
+
+#include <chrono>
+#include <cstddef>
+#include <new>
+#include <string>
+
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/io_context.hpp>
+
+#include "NmeaAsyncMulticast.h"
+
+#include "check.h"
+
+using boost::asio::ip::udp;
+
+const NmeaTrasmissionGroupEnum testGroup = NmeaTransmissionGroup_USR8;
+
+struct AllocationCounter {
+	std::size_t allocations = 0;
+	std::size_t deallocations = 0;
+};
+
+template<typename T>
+class CountingAllocator {
+public:
+	typedef T value_type;
+
+	explicit CountingAllocator(AllocationCounter& counter) :
+			counter(&counter) {
+	}
+
+	template<typename U>
+	CountingAllocator(const CountingAllocator<U>& other) :
+			counter(other.counter) {
+	}
+
+	T* allocate(std::size_t n) const {
+		++counter->allocations;
+		return static_cast<T*>(::operator new(sizeof(T) * n));
+	}
+
+	void deallocate(T* pointer, std::size_t) const {
+		++counter->deallocations;
+		::operator delete(pointer);
+	}
+
+	bool operator==(const CountingAllocator& other) const {
+		return counter == other.counter;
+	}
+
+	bool operator!=(const CountingAllocator& other) const {
+		return counter != other.counter;
+	}
+
+private:
+	template<typename > friend class CountingAllocator;
+
+	AllocationCounter* counter;
+};
+
+// Completion handler recording its result, with a counting associated allocator.
+struct CountingHandler {
+	typedef CountingAllocator<char> allocator_type;
+
+	AllocationCounter* counter;
+	bool* called;
+	boost::system::error_code* ec;
+	std::size_t* size;
+
+	allocator_type get_allocator() const {
+		return allocator_type(*counter);
+	}
+
+	void operator()(boost::system::error_code result, std::size_t n) {
+		*called = true;
+		*ec = result;
+		*size = n;
+	}
+};
+
+static void sendTooLarge() {
+	boost::asio::io_context io;
+	boost::asio::io_context handlerContext;
+	udp::socket socket(io);
+	socket.open(udp::v4());
+	NmeaAsyncMulticast nmea(socket, testGroup);
+
+	AllocationCounter counter;
+	bool called = false;
+	boost::system::error_code ec;
+	std::size_t size = 1;
+
+	nmea.async_send_string("GP0001", "$GPTXT," + std::string(8192, 'A') + "*00",
+			boost::asio::bind_executor(handlerContext,
+					CountingHandler { &counter, &called, &ec, &size }));
+	CHECK(!called);
+
+	// The error completes on the handler executor, not on the socket one.
+	io.run();
+	CHECK(!called);
+	handlerContext.run();
+	CHECK(called);
+	CHECK(ec == boost::asio::error::message_size);
+	CHECK(size == 0);
+
+	CHECK(counter.allocations > 0);
+	CHECK(counter.allocations == counter.deallocations);
+}
+
+static void loopback() {
+	boost::asio::io_context io;
+	boost::asio::io_context handlerContext;
+	udp::socket receiveSocket(io);
+	udp::socket sendSocket(io);
+	boost::system::error_code ec;
+	NmeaAsyncMulticast::joinGroup(receiveSocket, testGroup, ec);
+	CHECK(!ec);
+	NmeaAsyncMulticast::joinGroup(sendSocket, testGroup, ec);
+	CHECK(!ec);
+
+	NmeaAsyncMulticast receiver(receiveSocket, testGroup);
+	NmeaAsyncMulticast sender(sendSocket, testGroup);
+
+	AllocationCounter receiveCounter;
+	bool received = false;
+	boost::system::error_code receiveError;
+	std::size_t count = 0;
+	receiver.async_receive_sentences(
+			boost::asio::bind_executor(handlerContext,
+					CountingHandler { &receiveCounter, &received, &receiveError,
+							&count }));
+
+	AllocationCounter sendCounter;
+	bool sent = false;
+	boost::system::error_code sendError;
+	std::size_t bytes = 0;
+	sender.async_send_string("GP0001", "$GPHDT,123.4,T*00",
+			boost::asio::bind_executor(handlerContext,
+					CountingHandler { &sendCounter, &sent, &sendError, &bytes }));
+
+	// The socket context completes both operations, the handlers wait for their own context. Bounded in
+	// case the datagram is lost.
+	io.run_for(std::chrono::seconds(2));
+	CHECK(!sent);
+	CHECK(!received);
+	handlerContext.run_for(std::chrono::seconds(2));
+
+	CHECK(sent);
+	CHECK(!sendError);
+	CHECK(bytes > 0);
+	CHECK(received);
+	CHECK(!receiveError);
+	CHECK(count == 1);
+	if (count == 1) {
+		const NmeaDatagramLine& line = receiver.sentence(0);
+		CHECK(std::string(line.sourceId, line.sourceIdSize) == "GP0001");
+		CHECK(std::string(line.sentence, line.sentenceSize) == "$GPHDT,123.4,T*00");
+	}
+
+	CHECK(sendCounter.allocations > 0);
+	CHECK(sendCounter.allocations == sendCounter.deallocations);
+	CHECK(receiveCounter.allocations > 0);
+	CHECK(receiveCounter.allocations == receiveCounter.deallocations);
+}
+
+int main() {
+	sendTooLarge();
+	loopback();
+
+	return CHECK_RESULT();
+}
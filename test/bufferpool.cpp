@@ -0,0 +1,135 @@
+/*
+ * bufferpool.cpp
+ *
+ * NmeaBufferPool and NmeaBuffer: reference counting of shared handles, buffers going back to the pool,
+ * exhaustion and usage metrics, and the lock free free list under concurrent acquire and release.
+ */
+
+#include <atomic>
+#include <cstring>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "NmeaBufferPool.h"
+
+#include "check.h"
+
+const std::size_t bufferCount = 4;
+const std::size_t bufferSize = 100;
+
+int main() {
+	NmeaBufferPool pool(bufferCount, bufferSize);
+	CHECK(pool.capacity() == bufferCount);
+	CHECK(pool.bufferSize() == bufferSize);
+	CHECK(pool.available() == bufferCount);
+	CHECK(pool.peakInUse() == 0);
+
+	// Copies share the buffer, the last one to go returns it.
+	{
+		NmeaBuffer buffer = pool.acquire();
+		CHECK(buffer);
+		CHECK(buffer.useCount() == 1);
+		CHECK(buffer.size() == 0);
+		CHECK(buffer.capacity() == bufferSize);
+		CHECK(reinterpret_cast<uintptr_t>(buffer.data()) % 64 == 0);
+		memcpy(buffer.data(), "$GPHDT,1.0,T*00", 15);
+		buffer.resize(15);
+		CHECK(pool.available() == bufferCount - 1);
+
+		NmeaBuffer copy = buffer;
+		CHECK(buffer.useCount() == 2 && copy.useCount() == 2);
+		CHECK(copy.data() == buffer.data() && copy.size() == 15);
+
+		NmeaBuffer moved = std::move(copy);
+		CHECK(!copy);
+		CHECK(moved.useCount() == 2);
+
+		buffer.reset();
+		CHECK(!buffer);
+		CHECK(moved.useCount() == 1);
+		CHECK(pool.available() == bufferCount - 1);
+		CHECK(memcmp(moved.data(), "$GPHDT,1.0,T*00", 15) == 0);
+	}
+	CHECK(pool.available() == bufferCount);
+
+	// Exhaustion: every buffer is distinct, the next acquire fails and is counted.
+	{
+		std::vector<NmeaBuffer> held;
+		std::set<const char*> distinct;
+		for (std::size_t i = 0; i < bufferCount; ++i) {
+			held.push_back(pool.acquire());
+			CHECK(held.back());
+			distinct.insert(held.back().data());
+		}
+		CHECK(distinct.size() == bufferCount);
+		CHECK(pool.available() == 0);
+		CHECK(pool.peakInUse() == bufferCount);
+
+		uint64_t exhausted = pool.exhaustedCount();
+		NmeaBuffer none = pool.acquire();
+		CHECK(!none);
+		CHECK(none.useCount() == 0);
+		CHECK(pool.exhaustedCount() == exhausted + 1);
+
+		// A released buffer is handed out again, with its size cleared.
+		held[2].resize(10);
+		const char* released = held[2].data();
+		held[2] = NmeaBuffer();
+		CHECK(pool.available() == 1);
+		NmeaBuffer again = pool.acquire();
+		CHECK(again && again.data() == released && again.size() == 0);
+	}
+	CHECK(pool.available() == bufferCount);
+	CHECK(pool.peakInUse() == bufferCount);
+
+	// Several threads take, share and release buffers. A buffer held by two owners at once would show a
+	// foreign tag.
+	NmeaBufferPool shared(8, 64);
+	std::atomic<bool> corrupted(false);
+	std::atomic<uint64_t> acquired(0);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t) {
+		threads.emplace_back([&shared, &corrupted, &acquired, t]() {
+			char tag = static_cast<char>('A' + t);
+			for (int i = 0; i < 200000; ++i) {
+				NmeaBuffer buffer = shared.acquire();
+				if (!buffer) {
+					continue;
+				}
+				++acquired;
+				memset(buffer.data(), tag, 64);
+				NmeaBuffer copy = buffer;
+				buffer.reset();
+				for (int j = 0; j < 64; ++j) {
+					if (copy.data()[j] != tag) {
+						corrupted = true;
+					}
+				}
+			}
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	CHECK(!corrupted);
+	CHECK(acquired > 0);
+	CHECK(shared.available() == shared.capacity());
+	CHECK(shared.peakInUse() <= shared.capacity());
+
+	// Every buffer can still be taken once after the stress.
+	{
+		std::vector<NmeaBuffer> all;
+		std::set<const char*> distinct;
+		for (std::size_t i = 0; i < shared.capacity(); ++i) {
+			all.push_back(shared.acquire());
+			CHECK(all.back());
+			distinct.insert(all.back().data());
+		}
+		CHECK(distinct.size() == shared.capacity());
+		CHECK(!shared.acquire());
+	}
+
+	return CHECK_RESULT();
+}
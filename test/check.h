@@ -0,0 +1,30 @@
+/*
+ * check.h
+ *
+ * Minimal assertion helpers shared by the self checking test programs run by ctest.
+ */
+
+#ifndef TEST_CHECK_H_
+#define TEST_CHECK_H_
+
+#include <cstdio>
+
+static int checkFailures = 0;
+
+/**
+ * @brief Report a failed condition and keep going, so one run lists every failure.
+ */
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%d: falla '%s'\n", __FILE__, __LINE__, #condition); \
+			++checkFailures; \
+		} \
+	} while (false)
+
+/**
+ * @brief Exit status of the test program.
+ */
+#define CHECK_RESULT() ((checkFailures == 0) ? 0 : 1)
+
+#endif /* TEST_CHECK_H_ */
@@ -0,0 +1,129 @@
+/*
+ * conflation.cpp
+ *
+ * NmeaDeliveryMode_Conflated: a blocked listener only sees the newest value of each key once it resumes, and
+ * keys beyond the limit are counted as overflows.
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "NmeaMulticastUdp.h"
+#include "NmeaMulticastUdpListener.h"
+
+#include "check.h"
+
+class BlockingListener: public NmeaMulticastUdpListener {
+public:
+	BlockingListener() :
+			blocked(true) {
+	}
+
+	virtual void onStringAvailable(const std::string& sourceId,
+			const std::string& nmea) {
+		std::unique_lock<std::mutex> lock(m);
+		received.push_back(std::make_pair(sourceId, nmea));
+		changed.notify_all();
+		while (blocked) {
+			changed.wait(lock);
+		}
+	}
+
+	virtual void onTimeout() {
+	}
+
+	virtual void onConnectionError() {
+	}
+
+	virtual void onChecksumError() {
+	}
+
+	void release() {
+		std::lock_guard<std::mutex> lock(m);
+		blocked = false;
+		changed.notify_all();
+	}
+
+	bool waitFor(std::size_t count) {
+		std::unique_lock<std::mutex> lock(m);
+		return changed.wait_for(lock, std::chrono::seconds(2),
+				[&]() {return received.size() >= count;});
+	}
+
+	std::vector<std::pair<std::string, std::string>> deliveries() {
+		std::lock_guard<std::mutex> lock(m);
+		return received;
+	}
+
+private:
+	std::mutex m;
+	std::condition_variable changed;
+	bool blocked;
+	std::vector<std::pair<std::string, std::string>> received;
+};
+
+static bool waitUntil(std::function<bool()> condition) {
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+	while (!condition()) {
+		if (std::chrono::steady_clock::now() > deadline) {
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+	return true;
+}
+
+int main() {
+	const int updates = 50;
+
+	auto listener = std::make_shared<BlockingListener>();
+	NmeaMulticastUdp receiver(NmeaTransmissionGroup_USR7);
+	receiver.setListener(listener);
+	receiver.setDeliveryMode(NmeaDeliveryMode_Conflated, 2);
+	CHECK(receiver.startListening());
+
+	NmeaMulticastUdp sender(NmeaTransmissionGroup_USR7);
+	CHECK(sender.open());
+	sender.registerSystemId("GP0001");
+	sender.registerSystemId("GP0002");
+
+	// The dispatch thread takes the first value and stays blocked in the listener.
+	CHECK(sender.sendString("GP0001", "$GPHDT,0,T*00"));
+	CHECK(listener->waitFor(1));
+
+	for (int i = 1; i <= updates; ++i) {
+		sender.sendString("GP0001", "$GPHDT," + std::to_string(i) + ",T*00");
+		sender.sendString("GP0001", "$GPROT," + std::to_string(i) + ",A*00");
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+	// Third key with a limit of two.
+	for (int i = 0; i < 3; ++i) {
+		sender.sendString("GP0002", "$GPGGA," + std::to_string(i) + "*00");
+	}
+
+	CHECK(waitUntil([&]() {return receiver.conflationOverflowCount() == 3;}));
+	CHECK(waitUntil([&]() {return receiver.conflatedCount() == 2 * (updates - 1);}));
+
+	listener->release();
+	CHECK(listener->waitFor(3));
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	receiver.stopListening();
+
+	auto deliveries = listener->deliveries();
+	CHECK(deliveries.size() == 3);
+	if (deliveries.size() == 3) {
+		CHECK(deliveries[0].second == "$GPHDT,0,T*00");
+		CHECK(deliveries[1].first == "GP0001");
+		CHECK(deliveries[1].second == "$GPHDT,50,T*00");
+		CHECK(deliveries[2].second == "$GPROT,50,A*00");
+	}
+	CHECK(receiver.conflationOverflowCount() == 3);
+
+	return CHECK_RESULT();
+}
@@ -0,0 +1,327 @@
+/*
+ * flood.cpp
+ *
+ * Loopback stress test: producers flood several transmission groups with stamped sentences while listeners
+ * count what arrives. The offered load is ramped until the listeners lose data.
+ *
+ * Usage: flood.libNmeaMulticast [-g groups] [-p producers] [-l listeners] [-r start_rate] [-m max_rate]
+ *                               [-f factor] [-d step_ms] [-u]
+ *
+ *   -g  Number of transmission groups, starting at USR1 (default 3).
+ *   -p  Producer threads per group (default 2).
+ *   -l  Listeners per group (default 2).
+ *   -r  Initial offered load per group, sentences per second (default 1000).
+ *   -m  Maximum offered load per group (default 512000).
+ *   -f  Load multiplier between steps (default 2).
+ *   -d  Duration of each step in milliseconds (default 2000).
+ *   -u  Receive with the io_uring backend.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "NmeaMulticastUdp.h"
+#include "NmeaMulticastUdpListener.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static const std::size_t latencyBuckets = 10000;	// 1 us resolution up to 10 ms, last bucket is overflow.
+static const double lossThreshold = 0.05;
+
+static uint64_t nowNs() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			Clock::now().time_since_epoch()).count();
+}
+
+class FloodListener: public NmeaMulticastUdpListener {
+public:
+	explicit FloodListener(std::size_t producers) :
+			highest(producers), latency(latencyBuckets + 1) {
+		reset();
+	}
+
+	// Called while late datagrams of the previous step may still arrive, the listener only uses atomic
+	// increments so none of these stores is lost.
+	void reset() {
+		received = 0;
+		reordered = 0;
+		for (auto& bucket : latency) {
+			bucket.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	virtual void onStringAvailable(const std::string& sourceId,
+			const std::string& nmea) {
+		uint64_t arrival = nowNs();
+
+		// Source Id "FLpppp", sentence "$FLTXT,<sequence>,<timestamp ns>*00".
+		std::size_t producer = strtoul(sourceId.c_str() + 2, nullptr, 10);
+		const char* p = nmea.c_str() + 7;
+		char* end;
+		uint64_t sequence = strtoull(p, &end, 10);
+		uint64_t sent = strtoull(end + 1, nullptr, 10);
+		if (producer >= highest.size()) {
+			return;
+		}
+
+		received.fetch_add(1, std::memory_order_relaxed);
+		if (sequence < highest[producer]) {
+			reordered.fetch_add(1, std::memory_order_relaxed);
+		} else {
+			highest[producer] = sequence + 1;
+		}
+
+		std::size_t bucket = std::min<uint64_t>(
+				(arrival > sent) ? (arrival - sent) / 1000 : 0, latencyBuckets);
+		latency[bucket].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	virtual void onTimeout() {
+	}
+
+	virtual void onConnectionError() {
+	}
+
+	virtual void onChecksumError() {
+	}
+
+	std::atomic<uint64_t> received;
+	std::atomic<uint64_t> reordered;
+	std::vector<uint64_t> highest;
+	std::vector<std::atomic<uint32_t>> latency;
+};
+
+struct FloodGroup {
+	NmeaTrasmissionGroupEnum group;
+	std::vector<std::unique_ptr<NmeaMulticastUdp>> producers;
+	std::vector<std::unique_ptr<NmeaMulticastUdp>> receivers;
+	std::vector<std::shared_ptr<FloodListener>> listeners;
+	std::atomic<uint64_t> sent;
+};
+
+static const char* groupName(NmeaTrasmissionGroupEnum group) {
+	static const char* names[] = { "MISC", "TGTD", "SATD", "NAVD", "VDRD",
+			"RCOM", "TIME", "PROP", "USR1", "USR2", "USR3", "USR4", "USR5",
+			"USR6", "USR7", "USR8" };
+	return names[group];
+}
+
+static void produce(NmeaMulticastUdp& multicast, std::size_t producer,
+		double rate, Clock::time_point stop, std::atomic<uint64_t>& sent,
+		uint64_t& sequence) {
+	char sourceId[16];
+	snprintf(sourceId, sizeof(sourceId), "FL%04zu", producer);
+	std::string id(sourceId);
+	multicast.registerSystemId(id);
+
+	char sentence[64];
+	uint64_t count = 0;
+	Clock::time_point start = Clock::now();
+
+	while (Clock::now() < stop) {
+		// Send whatever is due, then yield for a short while.
+		double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+		uint64_t due = static_cast<uint64_t>(elapsed * rate);
+		while (count < due) {
+			int len = snprintf(sentence, sizeof(sentence), "$FLTXT,%llu,%llu*00",
+					static_cast<unsigned long long>(sequence),
+					static_cast<unsigned long long>(nowNs()));
+			multicast.sendString(id, std::string(sentence, len));
+			++sequence;
+			++count;
+		}
+		std::this_thread::sleep_for(std::chrono::microseconds(200));
+	}
+	sent += count;
+}
+
+static uint64_t percentile(const std::vector<uint64_t>& histogram,
+		uint64_t total, double fraction) {
+	uint64_t target = static_cast<uint64_t>(total * fraction);
+	uint64_t accumulated = 0;
+	for (std::size_t i = 0; i < histogram.size(); ++i) {
+		accumulated += histogram[i];
+		if (accumulated > target) {
+			return i;
+		}
+	}
+	return histogram.size() - 1;
+}
+
+int main(int argc, char* argv[]) {
+	std::size_t groupCount = 3;
+	std::size_t producerCount = 2;
+	std::size_t listenerCount = 2;
+	double rate = 1000;
+	double maxRate = 512000;
+	double factor = 2;
+	int stepMs = 2000;
+	bool ioUring = false;
+
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "-u") {
+			ioUring = true;
+		} else if (i + 1 < argc && arg == "-g") {
+			groupCount = std::min<std::size_t>(atoi(argv[++i]), 8);
+		} else if (i + 1 < argc && arg == "-p") {
+			producerCount = atoi(argv[++i]);
+		} else if (i + 1 < argc && arg == "-l") {
+			listenerCount = atoi(argv[++i]);
+		} else if (i + 1 < argc && arg == "-r") {
+			rate = atof(argv[++i]);
+		} else if (i + 1 < argc && arg == "-m") {
+			maxRate = atof(argv[++i]);
+		} else if (i + 1 < argc && arg == "-f") {
+			factor = atof(argv[++i]);
+		} else if (i + 1 < argc && arg == "-d") {
+			stepMs = atoi(argv[++i]);
+		} else {
+			fprintf(stderr, "Uso: %s [-g grupos] [-p productores] [-l oyentes] "
+					"[-r tasa_inicial] [-m tasa_maxima] [-f factor] [-d paso_ms] [-u]\n",
+					argv[0]);
+			return 1;
+		}
+	}
+	if (groupCount == 0 || producerCount == 0 || listenerCount == 0
+			|| rate <= 0 || factor <= 1) {
+		fprintf(stderr, "Parámetros no válidos\n");
+		return 1;
+	}
+
+	std::vector<std::unique_ptr<FloodGroup>> groups;
+	for (std::size_t g = 0; g < groupCount; ++g) {
+		std::unique_ptr<FloodGroup> group(new FloodGroup);
+		group->group = static_cast<NmeaTrasmissionGroupEnum>(
+				NmeaTransmissionGroup_USR1 + g);
+		group->sent = 0;
+		for (std::size_t p = 0; p < producerCount; ++p) {
+			group->producers.emplace_back(new NmeaMulticastUdp(group->group));
+			if (!group->producers.back()->open()) {
+				fprintf(stderr, "No se pudo abrir %s\n", groupName(group->group));
+				return 1;
+			}
+		}
+		for (std::size_t l = 0; l < listenerCount; ++l) {
+			group->listeners.push_back(
+					std::make_shared<FloodListener>(producerCount));
+			group->receivers.emplace_back(new NmeaMulticastUdp(group->group));
+			NmeaMulticastUdp& receiver = *group->receivers.back();
+			if (ioUring) {
+				receiver.setReceiveBackend(MulticastUdpReceiveBackend_IoUring);
+			}
+			receiver.setListener(group->listeners.back());
+			if (!receiver.startListening()) {
+				fprintf(stderr, "No se pudo escuchar %s\n", groupName(group->group));
+				return 1;
+			}
+		}
+		groups.push_back(std::move(group));
+	}
+
+	// Give the listening threads time to join their groups before the first step.
+	std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+	printf("%zu grupos, %zu productores y %zu oyentes por grupo, backend %s\n\n",
+			groupCount, producerCount, listenerCount,
+			(groups[0]->receivers[0]->getReceiveBackend()
+					== MulticastUdpReceiveBackend_IoUring) ? "io_uring" : "select");
+	printf("%10s %-5s %10s %10s %7s %8s %8s %8s %8s %8s\n", "OFFER/S", "GROUP",
+			"SENT/S", "DELIV/S", "LOSS%", "REORDER", "P50us", "P99us",
+			"P999us", "MAXus");
+
+	std::vector<std::vector<uint64_t>> sequences(groupCount,
+			std::vector<uint64_t>(producerCount, 0));
+	std::vector<uint64_t> histogram(latencyBuckets + 1);
+
+	for (; rate <= maxRate; rate *= factor) {
+		for (auto& group : groups) {
+			group->sent = 0;
+			for (auto& listener : group->listeners) {
+				listener->reset();
+			}
+		}
+
+		Clock::time_point stop = Clock::now()
+				+ std::chrono::milliseconds(stepMs);
+		std::vector<std::thread> threads;
+		for (std::size_t g = 0; g < groupCount; ++g) {
+			for (std::size_t p = 0; p < producerCount; ++p) {
+				threads.emplace_back(produce,
+						std::ref(*groups[g]->producers[p]), p,
+						rate / producerCount, stop, std::ref(groups[g]->sent),
+						std::ref(sequences[g][p]));
+			}
+		}
+		for (auto& t : threads) {
+			t.join();
+		}
+
+		// Let the listeners drain their socket buffers.
+		std::this_thread::sleep_for(std::chrono::milliseconds(300));
+
+		double seconds = stepMs / 1000.0;
+		bool broken = true;
+		for (auto& group : groups) {
+			uint64_t sent = group->sent;
+			uint64_t received = 0;
+			uint64_t reordered = 0;
+			std::fill(histogram.begin(), histogram.end(), 0);
+			for (auto& listener : group->listeners) {
+				received += listener->received;
+				reordered += listener->reordered;
+				for (std::size_t i = 0; i <= latencyBuckets; ++i) {
+					histogram[i] += listener->latency[i].load(
+							std::memory_order_relaxed);
+				}
+			}
+
+			uint64_t expected = sent * listenerCount;
+			double loss = (expected > 0) ?
+					1.0 - static_cast<double>(received) / expected : 0;
+			if (loss < lossThreshold) {
+				broken = false;
+			}
+
+			uint64_t maximum = 0;
+			for (std::size_t i = 0; i <= latencyBuckets; ++i) {
+				if (histogram[i] > 0) {
+					maximum = i;
+				}
+			}
+
+			printf("%10.0f %-5s %10.0f %10.0f %7.2f %8llu %8llu %8llu %8llu %7s%llu\n",
+					rate, groupName(group->group), sent / seconds,
+					received / seconds / listenerCount,
+					std::max(loss, 0.0) * 100.0,
+					static_cast<unsigned long long>(reordered),
+					static_cast<unsigned long long>(percentile(histogram, received, 0.5)),
+					static_cast<unsigned long long>(percentile(histogram, received, 0.99)),
+					static_cast<unsigned long long>(percentile(histogram, received, 0.999)),
+					(maximum == latencyBuckets) ? ">" : "",
+					static_cast<unsigned long long>(maximum));
+		}
+		fflush(stdout);
+
+		if (broken) {
+			printf("\nTodos los grupos pierden más del %.0f%% a %.0f sentencias/s por grupo\n",
+					lossThreshold * 100, rate);
+			break;
+		}
+	}
+
+	for (auto& group : groups) {
+		for (auto& receiver : group->receivers) {
+			receiver->stopListening();
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,184 @@
+/*
+ * groupassembler.cpp
+ *
+ * NmeaGroupAssembler driven line by line: groups in and out of order, repeated lines, groups of different
+ * sources, timeout through expire(), eviction when every slot is busy, the MaxGroupLines bound and slot
+ * overflow.
+ */
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "NmeaGroupAssembler.h"
+#include "NmeaMulticastUdp.h"
+
+#include "check.h"
+
+using std::chrono::milliseconds;
+
+// Sentences must outlive the lines pointing at them.
+static std::vector<std::string> sentences;
+
+static NmeaDatagramLine groupLine(const char* sourceId, unsigned groupId,
+		unsigned line, unsigned size) {
+	sentences.push_back("$GPTXT," + std::to_string(groupId) + ","
+			+ std::to_string(line) + "*00");
+	const std::string& sentence = sentences.back();
+
+	NmeaDatagramLine result = NmeaDatagramLine();
+	result.sourceId = sourceId;
+	result.sourceIdSize = std::char_traits<char>::length(sourceId);
+	result.groupLine = line;
+	result.groupSize = size;
+	result.groupId = groupId;
+	result.sentence = sentence.data();
+	result.sentenceSize = sentence.size();
+	return result;
+}
+
+static std::string expectedBlock(unsigned groupId, unsigned size) {
+	std::string block;
+	for (unsigned line = 1; line <= size; ++line) {
+		block += "$GPTXT," + std::to_string(groupId) + ","
+				+ std::to_string(line) + "*00\r\n";
+	}
+	return block;
+}
+
+// Adds the line and returns the assembled block, or an empty string while the group is incomplete.
+static std::string add(NmeaGroupAssembler& assembler,
+		const NmeaDatagramLine& line, std::size_t expectedLines = 0) {
+	const char* block = nullptr;
+	std::size_t size = 0;
+	std::size_t lines = 0;
+	if (!assembler.add(line, block, size, lines)) {
+		return std::string();
+	}
+	if (expectedLines != 0) {
+		CHECK(lines == expectedLines);
+	}
+	return std::string(block, size);
+}
+
+static void orderedAndUnordered() {
+	NmeaGroupAssembler assembler(4, 1024, milliseconds(1000));
+
+	CHECK(add(assembler, groupLine("GP0001", 1, 1, 3)).empty());
+	CHECK(add(assembler, groupLine("GP0001", 1, 2, 3)).empty());
+	CHECK(add(assembler, groupLine("GP0001", 1, 3, 3), 3) == expectedBlock(1, 3));
+
+	CHECK(add(assembler, groupLine("GP0001", 2, 3, 3)).empty());
+	CHECK(add(assembler, groupLine("GP0001", 2, 1, 3)).empty());
+	CHECK(add(assembler, groupLine("GP0001", 2, 2, 3), 3) == expectedBlock(2, 3));
+
+	// The same group Id from two sources are two groups.
+	CHECK(add(assembler, groupLine("GP0001", 3, 1, 2)).empty());
+	CHECK(add(assembler, groupLine("GP0002", 3, 2, 2)).empty());
+	CHECK(add(assembler, groupLine("GP0002", 3, 1, 2), 2) == expectedBlock(3, 2));
+	CHECK(add(assembler, groupLine("GP0001", 3, 2, 2), 2) == expectedBlock(3, 2));
+
+	// A repeated line keeps the first copy and does not complete the group.
+	CHECK(add(assembler, groupLine("GP0001", 4, 1, 2)).empty());
+	CHECK(add(assembler, groupLine("GP0001", 4, 1, 2)).empty());
+	CHECK(add(assembler, groupLine("GP0001", 4, 2, 2), 2) == expectedBlock(4, 2));
+
+	// Single line groups complete at once.
+	CHECK(add(assembler, groupLine("GP0001", 5, 1, 1), 1) == expectedBlock(5, 1));
+
+	CHECK(assembler.droppedCount() == 0);
+}
+
+static void timeout() {
+	NmeaGroupAssembler assembler(4, 1024, milliseconds(20));
+
+	CHECK(add(assembler, groupLine("GP0001", 1, 1, 2)).empty());
+	assembler.expire();
+	CHECK(assembler.droppedCount() == 0);
+
+	std::this_thread::sleep_for(milliseconds(50));
+	assembler.expire();
+	CHECK(assembler.droppedCount() == 1);
+
+	// The rest of the expired group starts a new one.
+	CHECK(add(assembler, groupLine("GP0001", 1, 2, 2)).empty());
+	CHECK(add(assembler, groupLine("GP0001", 1, 1, 2), 2) == expectedBlock(1, 2));
+	CHECK(assembler.droppedCount() == 1);
+
+	// A stale group whose Id is reused without expire() is dropped when the Id comes back.
+	CHECK(add(assembler, groupLine("GP0001", 2, 1, 2)).empty());
+	std::this_thread::sleep_for(milliseconds(50));
+	CHECK(add(assembler, groupLine("GP0001", 2, 2, 2)).empty());
+	CHECK(assembler.droppedCount() == 2);
+}
+
+static void eviction() {
+	NmeaGroupAssembler assembler(2, 1024, milliseconds(1000));
+
+	CHECK(add(assembler, groupLine("GP0001", 1, 1, 2)).empty());
+	std::this_thread::sleep_for(milliseconds(2));
+	CHECK(add(assembler, groupLine("GP0001", 2, 1, 2)).empty());
+	std::this_thread::sleep_for(milliseconds(2));
+
+	// Every slot is busy, the oldest group is evicted.
+	CHECK(add(assembler, groupLine("GP0001", 3, 1, 2)).empty());
+	CHECK(assembler.droppedCount() == 1);
+
+	CHECK(add(assembler, groupLine("GP0001", 2, 2, 2), 2) == expectedBlock(2, 2));
+	CHECK(add(assembler, groupLine("GP0001", 3, 2, 2), 2) == expectedBlock(3, 2));
+	CHECK(add(assembler, groupLine("GP0001", 1, 2, 2)).empty());
+	CHECK(assembler.droppedCount() == 1);
+
+	// Without slots every line is dropped and counted.
+	NmeaGroupAssembler empty(0, 1024, milliseconds(1000));
+	CHECK(add(empty, groupLine("GP0001", 1, 1, 1)).empty());
+	CHECK(empty.droppedCount() == 1);
+}
+
+static void bounds() {
+	const unsigned maxLines = NmeaGroupAssembler::MaxGroupLines;
+	NmeaGroupAssembler assembler(2, 64 * 1024, milliseconds(1000));
+
+	CHECK(add(assembler, groupLine("GP0001", 1, 1, maxLines + 1)).empty());
+	CHECK(assembler.droppedCount() == 1);
+
+	// The largest group, last line first.
+	std::string block = add(assembler, groupLine("GP0001", 2, maxLines, maxLines));
+	CHECK(block.empty());
+	for (unsigned line = 1; line < maxLines; ++line) {
+		block = add(assembler, groupLine("GP0001", 2, line, maxLines), maxLines);
+	}
+	CHECK(block == expectedBlock(2, maxLines));
+
+	// Source Ids longer than the TAG block allows.
+	CHECK(add(assembler, groupLine("GP0123456789ABCDE", 3, 1, 1)).empty());
+	CHECK(assembler.droppedCount() == 2);
+
+	// A group larger than the slot is dropped when it overflows.
+	NmeaGroupAssembler small(1, 40, milliseconds(1000));
+	CHECK(add(small, groupLine("GP0001", 1, 1, 3)).empty());
+	CHECK(add(small, groupLine("GP0001", 1, 2, 3)).empty());
+	CHECK(add(small, groupLine("GP0001", 1, 3, 3)).empty());
+	CHECK(small.droppedCount() == 1);
+}
+
+static void configuration() {
+	NmeaMulticastUdp udp(NmeaTransmissionGroup_USR8);
+	CHECK(!udp.setGroupAssembly(true, 0));
+	CHECK(!udp.setGroupAssembly(true, 16, 0));
+	CHECK(udp.setGroupAssembly(true, 1, 100));
+	CHECK(udp.setGroupAssembly(false, 0));
+}
+
+int main() {
+	sentences.reserve(1024);
+
+	orderedAndUnordered();
+	timeout();
+	eviction();
+	bounds();
+	configuration();
+
+	return CHECK_RESULT();
+}
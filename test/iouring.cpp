@@ -0,0 +1,198 @@
+/*
+ * iouring.cpp
+ *
+ * io_uring receive backend over loopback: datagrams received through the provided buffer ring, the multishot
+ * request armed again after every buffer was in use, oversized datagrams dropped and counted, and
+ * MulticastUdp falling back to select() when io_uring is not available.
+ *
+ * Exits with 77 (skipped) where io_uring is not available.
+ */
+
+#include <arpa/inet.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+#include <netinet/in.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "IoUringReceiver.h"
+#include "MulticastUdp.h"
+#include "NmeaMulticastUdp.h"
+
+#include "check.h"
+
+const NmeaTrasmissionGroupEnum testGroup = NmeaTransmissionGroup_USR1;
+
+static MulticastUdp groupSocket() {
+	MulticastUdp udp("0.0.0.0",
+			NmeaMulticastUdp::transmissionGroupAddress(testGroup),
+			NmeaMulticastUdp::transmissionGroupPort(testGroup), 500);
+	udp.setReceiveBackend(MulticastUdpReceiveBackend_IoUring);
+	return udp;
+}
+
+// Unicast loopback pair with a receive queue large enough to hold every datagram of the test.
+struct LoopbackPair {
+	int receiver;
+	int sender;
+	sockaddr_in address;
+
+	LoopbackPair() {
+		receiver = socket(AF_INET, SOCK_DGRAM, 0);
+		sender = socket(AF_INET, SOCK_DGRAM, 0);
+
+		int size = 1 << 20;
+		setsockopt(receiver, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		bind(receiver, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+		socklen_t length = sizeof(address);
+		getsockname(receiver, reinterpret_cast<sockaddr*>(&address), &length);
+	}
+
+	~LoopbackPair() {
+		close(receiver);
+		close(sender);
+	}
+
+	void send(const std::string& datagram) {
+		sendto(sender, datagram.data(), datagram.size(), 0,
+				reinterpret_cast<sockaddr*>(&address), sizeof(address));
+	}
+};
+
+static bool ioUringAvailable() {
+	LoopbackPair pair;
+	IoUringReceiver receiver(256, 8);
+	return receiver.open(pair.receiver);
+}
+
+static std::string payload(unsigned index) {
+	return "datagrama " + std::to_string(index);
+}
+
+static void bufferRing() {
+	const unsigned bufferCount = 8;
+	LoopbackPair pair;
+	IoUringReceiver receiver(256, bufferCount);
+	CHECK(receiver.open(pair.receiver));
+
+	timeval timeout = { 1, 0 };
+	const char* data = nullptr;
+
+	// Four times the ring: the multishot request stops with ENOBUFS and must be armed again.
+	for (unsigned i = 0; i < 4 * bufferCount; ++i) {
+		pair.send(payload(i));
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	for (unsigned i = 0; i < 4 * bufferCount; ++i) {
+		int len = receiver.receive(data, timeout);
+		CHECK(len > 0 && std::string(data, len) == payload(i));
+	}
+	CHECK(receiver.exhaustedCount() > 0);
+
+	// Larger than the payload size: dropped, counted, and the next datagram is received.
+	pair.send(std::string(300, 'X'));
+	pair.send(payload(100));
+	int len = receiver.receive(data, timeout);
+	CHECK(len > 0 && std::string(data, len) == payload(100));
+	CHECK(receiver.truncatedCount() == 1);
+
+	timeval shortTimeout = { 0, 50000 };
+	CHECK(receiver.receive(data, shortTimeout) == -2);
+
+	receiver.close();
+	CHECK(!receiver.isOpen());
+}
+
+static void multicast() {
+	MulticastUdp udp = groupSocket();
+	CHECK(udp.open());
+	CHECK(udp.getReceiveBackend() == MulticastUdpReceiveBackend_IoUring);
+
+	std::string first = payload(1);
+	std::string oversized(40000, 'X');
+	std::string last = payload(2);
+	CHECK(udp.send(first.data(), first.size()) > 0);
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	CHECK(udp.send(oversized.data(), oversized.size()) > 0);
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	CHECK(udp.send(last.data(), last.size()) > 0);
+
+	const char* data = nullptr;
+	int len = udp.receive(data);
+	CHECK(len > 0 && std::string(data, len) == first);
+
+	// The oversized datagram is skipped, recv() never reports more than the buffer.
+	char buffer[256];
+	len = udp.recv(buffer, sizeof(buffer));
+	CHECK(len > 0 && std::string(buffer, len) == last);
+	CHECK(udp.dropCount() >= 1);
+
+	CHECK(udp.receive(data) <= 0);
+	udp.close();
+}
+
+// Runs in a child process where io_uring_setup fails, as on kernels where io_uring is disabled.
+static int fallback() {
+	sock_filter filter[] = {
+			BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(seccomp_data, nr)),
+			BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_io_uring_setup, 0, 1),
+			BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ERRNO | (ENOSYS & SECCOMP_RET_DATA)),
+			BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW) };
+	sock_fprog program = { sizeof(filter) / sizeof(filter[0]), filter };
+	if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) != 0
+			|| prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &program) != 0) {
+		return 77;
+	}
+
+	MulticastUdp udp = groupSocket();
+	CHECK(udp.open());
+	CHECK(udp.getReceiveBackend() == MulticastUdpReceiveBackend_Select);
+
+	std::string sent = payload(3);
+	CHECK(udp.send(sent.data(), sent.size()) > 0);
+	char buffer[256];
+	int len = udp.recv(buffer, sizeof(buffer));
+	CHECK(len > 0 && std::string(buffer, len) == sent);
+	udp.close();
+
+	return CHECK_RESULT();
+}
+
+int main() {
+	pid_t child = fork();
+	if (child == 0) {
+		_exit(fallback());
+	}
+	int status = 0;
+	waitpid(child, &status, 0);
+	CHECK(WIFEXITED(status));
+	if (WIFEXITED(status) && WEXITSTATUS(status) == 77) {
+		fprintf(stderr, "seccomp no disponible, no se prueba el cambio a select\n");
+	} else {
+		CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	}
+
+	if (!ioUringAvailable()) {
+		fprintf(stderr, "io_uring no disponible\n");
+		return (checkFailures == 0) ? 77 : 1;
+	}
+
+	bufferRing();
+	multicast();
+
+	return CHECK_RESULT();
+}
@@ -0,0 +1,182 @@
+/*
+ * kernelfilter.cpp
+ *
+ * Loopback test of the receive side filters: the BPF formatter filter accepts and rejects datagrams in the
+ * kernel, source specific joins only let the given senders through.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MulticastUdp.h"
+#include "MulticastUdpListener.h"
+#include "NmeaMulticastUdp.h"
+#include "NmeaMulticastUdpListener.h"
+
+#include "check.h"
+
+const int skipTest = 77;
+const NmeaTrasmissionGroupEnum testGroup = NmeaTransmissionGroup_USR3;
+
+class NullListener: public NmeaMulticastUdpListener {
+public:
+	virtual void onStringAvailable(const std::string&, const std::string&) {
+	}
+
+	virtual void onTimeout() {
+	}
+
+	virtual void onConnectionError() {
+	}
+
+	virtual void onChecksumError() {
+	}
+};
+
+class NullUdpListener: public MulticastUdpListener {
+public:
+	virtual void onDataAvailable(const char*, size_t) {
+	}
+
+	virtual void onTimeout() {
+	}
+
+	virtual void onConnectionError() {
+	}
+};
+
+// Address the kernel uses as source of the datagrams sent to the test group.
+static std::string localSender() {
+	int fd = socket(AF_INET, SOCK_DGRAM, 0);
+	sockaddr_in group;
+	memset(&group, 0, sizeof(group));
+	group.sin_family = AF_INET;
+	group.sin_port = htons(NmeaMulticastUdp::transmissionGroupPort(testGroup));
+	inet_aton(NmeaMulticastUdp::transmissionGroupAddress(testGroup).c_str(),
+			&group.sin_addr);
+	sockaddr_in local;
+	socklen_t size = sizeof(local);
+	std::string address;
+	if (connect(fd, reinterpret_cast<sockaddr*>(&group), sizeof(group)) == 0
+			&& getsockname(fd, reinterpret_cast<sockaddr*>(&local), &size) == 0) {
+		address = inet_ntoa(local.sin_addr);
+	}
+	close(fd);
+	return address;
+}
+
+// Every sentence received until the first timeout.
+static std::vector<std::string> drain(NmeaMulticastUdp& receiver) {
+	std::vector<std::string> received;
+	std::string sourceId;
+	std::string nmea;
+	while (receiver.recvString(sourceId, nmea)) {
+		received.push_back(nmea);
+	}
+	return received;
+}
+
+static void sendAll(NmeaMulticastUdp& sender, MulticastUdp& raw) {
+	sender.sendString("GP0001", "$GPHDT,1.0,T*00");
+	sender.sendString("GP0001", "$GPROT,2.0,A*00");
+	sender.sendString("GP0001", "$HETHS,3.0,A*00");
+	const char garbage[] = "$GPHDT,4.0,T*00\r\n";
+	raw.send(garbage, sizeof(garbage) - 1);
+}
+
+int main() {
+	std::string sender = localSender();
+	if (sender.empty()) {
+		fprintf(stderr, "Sin ruta multicast, se omite\n");
+		return skipTest;
+	}
+
+	NmeaMulticastUdp producer(testGroup);
+	MulticastUdp raw("0.0.0.0",
+			NmeaMulticastUdp::transmissionGroupAddress(testGroup),
+			NmeaMulticastUdp::transmissionGroupPort(testGroup), 100);
+	CHECK(producer.open());
+	CHECK(raw.open());
+
+	// No filter: everything arrives, the datagram without header is skipped in user space.
+	{
+		NmeaMulticastUdp receiver(testGroup);
+		CHECK(receiver.open());
+		sendAll(producer, raw);
+		std::vector<std::string> received = drain(receiver);
+		CHECK(received.size() == 3);
+	}
+
+	// Formatter filter: only HDT and THS datagrams with a header reach the socket.
+	{
+		NmeaMulticastUdp receiver(testGroup);
+		CHECK(receiver.setKernelFilter(true, { "HDT", "THS" }));
+		CHECK(receiver.open());
+		sendAll(producer, raw);
+		std::vector<std::string> received = drain(receiver);
+		CHECK(received.size() == 2);
+		if (received.size() == 2) {
+			CHECK(received[0] == "$GPHDT,1.0,T*00");
+			CHECK(received[1] == "$HETHS,3.0,A*00");
+		}
+		CHECK(!receiver.setKernelFilter(true, { "HDTX" }));
+	}
+
+	// Source specific join with the local sender.
+	{
+		NmeaMulticastUdp receiver(testGroup);
+		CHECK(receiver.setSourceFilter( { sender }));
+		if (!receiver.open()) {
+			fprintf(stderr, "IP_ADD_SOURCE_MEMBERSHIP no disponible, se omite\n");
+			return skipTest;
+		}
+		producer.sendString("GP0001", "$GPHDT,5.0,T*00");
+		CHECK(drain(receiver).size() == 1);
+	}
+
+	// Source specific join with another sender.
+	{
+		NmeaMulticastUdp receiver(testGroup);
+		CHECK(receiver.setSourceFilter( { "192.0.2.123" }));
+		CHECK(!receiver.setSourceFilter( { "no es una dirección" }));
+		CHECK(receiver.open());
+		producer.sendString("GP0001", "$GPHDT,6.0,T*00");
+		CHECK(drain(receiver).empty());
+	}
+
+	// The source list and the socket filter cannot change while the listening thread uses them.
+	{
+		NmeaMulticastUdp receiver(testGroup);
+		receiver.setListener(std::make_shared<NullListener>());
+		CHECK(receiver.startListening());
+		CHECK(!receiver.setSourceFilter( { sender }));
+		CHECK(!receiver.setKernelFilter(true, { "HDT" }));
+		receiver.stopListening();
+		CHECK(receiver.setSourceFilter( { sender }));
+		CHECK(receiver.setKernelFilter(true, { "HDT" }));
+	}
+	{
+		MulticastUdp receiver("0.0.0.0",
+				NmeaMulticastUdp::transmissionGroupAddress(testGroup),
+				NmeaMulticastUdp::transmissionGroupPort(testGroup), 100);
+		receiver.setListener(std::make_shared<NullUdpListener>());
+		receiver.startListening();
+		CHECK(receiver.isOpen());
+		CHECK(!receiver.setSocketFilter( { { 0x06, 0, 0, 0 } }));
+		CHECK(!receiver.setSourceFilter( { sender }));
+		receiver.stopListening();
+		CHECK(receiver.setSocketFilter( { { 0x06, 0, 0, 0 } }));
+		CHECK(receiver.setSocketFilter( { }));
+	}
+
+	return CHECK_RESULT();
+}
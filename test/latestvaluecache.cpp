@@ -0,0 +1,85 @@
+/*
+ * latestvaluecache.cpp
+ *
+ * NmeaLatestValueCache: snapshots taken while another thread updates the same key are never torn.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "NmeaLatestValueCache.h"
+
+#include "check.h"
+
+// Every field of the sentence repeats the same counter, a torn copy mixes two of them.
+static std::string sentence(unsigned long counter) {
+	std::string n = std::to_string(counter);
+	return "$GPHDT," + n + "," + n + "," + n + "*00";
+}
+
+static bool consistent(const NmeaLatestValue& value) {
+	if (strlen(value.sentence) != value.length
+			|| strncmp(value.sentence, "$GPHDT,", 7) != 0
+			|| strcmp(value.address, "GPHDT") != 0
+			|| strcmp(value.sourceId, "GP0001") != 0) {
+		return false;
+	}
+	char* end;
+	unsigned long first = strtoul(value.sentence + 7, &end, 10);
+	unsigned long second = strtoul(end + 1, &end, 10);
+	unsigned long third = strtoul(end + 1, &end, 10);
+	return first == second && second == third && strcmp(end, "*00") == 0;
+}
+
+int main() {
+	NmeaLatestValueCache cache(16);
+
+	NmeaLatestValue value;
+	CHECK(!cache.snapshot("GP0001", "GPHDT", value));
+	CHECK(cache.update("GP0001", sentence(0)));
+	CHECK(cache.snapshot("GP0001", "GPHDT", value));
+	CHECK(consistent(value));
+	CHECK(!cache.update("GP0001", "GPHDT"));
+	CHECK(cache.size() == 1);
+
+	std::atomic<bool> running(true);
+	std::thread writer([&]() {
+		// Counters of varying width also change the sentence length between writes.
+		for (unsigned long counter = 1; running; ++counter) {
+			cache.update("GP0001", sentence(counter % 1000003));
+		}
+	});
+
+	std::atomic<unsigned long> torn(0);
+	std::atomic<unsigned long> reads(0);
+	std::vector<std::thread> readers;
+	for (int r = 0; r < 3; ++r) {
+		readers.emplace_back([&]() {
+			NmeaLatestValue v;
+			while (running) {
+				if (!cache.snapshot("GP0001", "GPHDT", v) || !consistent(v)) {
+					++torn;
+				}
+				++reads;
+			}
+		});
+	}
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(300));
+	running = false;
+	writer.join();
+	for (auto& t : readers) {
+		t.join();
+	}
+
+	CHECK(reads > 0);
+	CHECK(torn == 0);
+	CHECK(cache.size() == 1);
+
+	return CHECK_RESULT();
+}
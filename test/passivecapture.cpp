@@ -0,0 +1,151 @@
+/*
+ * passivecapture.cpp
+ *
+ * NmeaPassiveCapture on the loopback interface: captures datagrams sent to a transmission group and ignores
+ * first fragments. Needs CAP_NET_RAW, skipped otherwise.
+ */
+
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "NmeaDatagram.h"
+#include "NmeaMulticastUdp.h"
+#include "NmeaPassiveCapture.h"
+#include "NmeaPassiveCaptureListener.h"
+
+#include "check.h"
+
+const int skipTest = 77;
+const NmeaTrasmissionGroupEnum testGroup = NmeaTransmissionGroup_USR4;
+
+class CaptureListener: public NmeaPassiveCaptureListener {
+public:
+	virtual void onStringAvailable(NmeaTrasmissionGroupEnum transmissionGroup,
+			const std::string& sourceId, const std::string& nmea) {
+		std::lock_guard<std::mutex> lock(m);
+		if (transmissionGroup == testGroup) {
+			sentences.push_back(sourceId + " " + nmea);
+		}
+	}
+
+	virtual void onTimeout() {
+	}
+
+	virtual void onConnectionError() {
+	}
+
+	std::vector<std::string> captured() {
+		std::lock_guard<std::mutex> lock(m);
+		return sentences;
+	}
+
+private:
+	std::mutex m;
+	std::vector<std::string> sentences;
+};
+
+static std::size_t datagram(char* buffer, std::size_t capacity,
+		const std::string& nmea) {
+	NmeaDatagramWriter writer(buffer, capacity);
+	writer.writeTagBlock("GP0001", 6, 1);
+	writer.writeSentence(nmea.data(), nmea.size());
+	return writer.size();
+}
+
+// Multicast sent through the loopback interface, without touching the routing table.
+static bool loopbackInterface(int fd) {
+	ip_mreqn request;
+	memset(&request, 0, sizeof(request));
+	request.imr_ifindex = if_nametoindex("lo");
+	return setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &request,
+			sizeof(request)) == 0;
+}
+
+static bool waitFor(CaptureListener& listener, std::size_t count) {
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+	while (listener.captured().size() < count) {
+		if (std::chrono::steady_clock::now() > deadline) {
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+	return true;
+}
+
+int main() {
+	auto listener = std::make_shared<CaptureListener>();
+	NmeaPassiveCapture capture("lo", 1 << 16, 4, 100);
+	capture.setListener(listener);
+	if (!capture.startListening()) {
+		fprintf(stderr, "No se pudo abrir la captura, se omite\n");
+		return skipTest;
+	}
+
+	sockaddr_in group;
+	memset(&group, 0, sizeof(group));
+	group.sin_family = AF_INET;
+	group.sin_port = htons(NmeaMulticastUdp::transmissionGroupPort(testGroup));
+	inet_aton(NmeaMulticastUdp::transmissionGroupAddress(testGroup).c_str(),
+			&group.sin_addr);
+
+	int udp = socket(AF_INET, SOCK_DGRAM, 0);
+	int raw = socket(AF_INET, SOCK_RAW, IPPROTO_RAW);
+	CHECK(loopbackInterface(udp));
+	CHECK(loopbackInterface(raw));
+
+	char buffer[256];
+	std::size_t size = datagram(buffer, sizeof(buffer), "$GPHDT,1.0,T*00");
+	CHECK(sendto(udp, buffer, size, 0, reinterpret_cast<sockaddr*>(&group),
+			sizeof(group)) == static_cast<ssize_t>(size));
+	CHECK(waitFor(*listener, 1));
+
+	// First fragment of a larger datagram: offset 0 with the more fragments flag set.
+	unsigned char packet[256];
+	memset(packet, 0, sizeof(packet));
+	size = datagram(reinterpret_cast<char*>(packet) + 28, sizeof(packet) - 28,
+			"$GPHDT,9.0,T*00");
+	iphdr* ip = reinterpret_cast<iphdr*>(packet);
+	ip->version = 4;
+	ip->ihl = 5;
+	ip->ttl = 1;
+	ip->protocol = IPPROTO_UDP;
+	ip->frag_off = htons(IP_MF);
+	ip->tot_len = htons(28 + size);
+	ip->saddr = htonl(INADDR_LOOPBACK);
+	ip->daddr = group.sin_addr.s_addr;
+	uint16_t udpHeader[4] = { htons(60000), group.sin_port, htons(
+			8 + size + 1000), 0 };
+	memcpy(packet + 20, udpHeader, sizeof(udpHeader));
+	CHECK(sendto(raw, packet, 28 + size, 0, reinterpret_cast<sockaddr*>(&group),
+			sizeof(group)) == static_cast<ssize_t>(28 + size));
+
+	size = datagram(buffer, sizeof(buffer), "$GPHDT,2.0,T*00");
+	CHECK(sendto(udp, buffer, size, 0, reinterpret_cast<sockaddr*>(&group),
+			sizeof(group)) == static_cast<ssize_t>(size));
+	CHECK(waitFor(*listener, 2));
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	capture.stopListening();
+	::close(udp);
+	::close(raw);
+
+	auto captured = listener->captured();
+	CHECK(captured.size() == 2);
+	if (captured.size() == 2) {
+		CHECK(captured[0] == "GP0001 $GPHDT,1.0,T*00");
+		CHECK(captured[1] == "GP0001 $GPHDT,2.0,T*00");
+	}
+	CHECK(capture.capturedCount() == 2);
+
+	return CHECK_RESULT();
+}
@@ -0,0 +1,118 @@
+/*
+ * relay.cpp
+ *
+ * Loopback test of NmeaRelay: sentences of a multi-line "g:" datagram are forwarded with a rewritten TAG
+ * block, "n:" counts per target group and source Id, rate limited rules skip, cycles are rejected.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MulticastUdp.h"
+#include "NmeaRelay.h"
+
+#include "check.h"
+
+const NmeaTrasmissionGroupEnum sourceGroup = NmeaTransmissionGroup_USR5;
+const NmeaTrasmissionGroupEnum targetGroup = NmeaTransmissionGroup_USR6;
+
+// TAG block with its checksum, computed independently of the library.
+static std::string tagBlock(const std::string& fields) {
+	unsigned char checksum = 0;
+	for (char c : fields) {
+		checksum ^= static_cast<unsigned char>(c);
+	}
+	char hex[3];
+	snprintf(hex, sizeof(hex), "%02X", checksum);
+	return "\\" + fields + "*" + hex + "\\";
+}
+
+static std::string datagram(const std::string& lines) {
+	return std::string("UdPbC", 6) + lines;
+}
+
+static MulticastUdp groupSocket(NmeaTrasmissionGroupEnum group) {
+	return MulticastUdp("0.0.0.0", NmeaMulticastUdp::transmissionGroupAddress(group),
+			NmeaMulticastUdp::transmissionGroupPort(group), 500);
+}
+
+static void expectCycleRejected() {
+	NmeaRelay relay;
+	CHECK(!relay.addRule( { sourceGroup, "", "", 0, sourceGroup, "" }));
+	CHECK(relay.addRule( { NmeaTransmissionGroup_USR5, "", "", 0,
+			NmeaTransmissionGroup_USR6, "" }));
+	CHECK(relay.addRule( { NmeaTransmissionGroup_USR6, "GPHDT", "", 0,
+			NmeaTransmissionGroup_USR7, "" }));
+	CHECK(!relay.addRule( { NmeaTransmissionGroup_USR7, "", "", 0,
+			NmeaTransmissionGroup_USR5, "" }));
+	CHECK(relay.addRule( { NmeaTransmissionGroup_USR7, "", "", 0,
+			NmeaTransmissionGroup_USR8, "" }));
+	CHECK(!relay.addRule( { NmeaTransmissionGroup_USR8, "", "", 0,
+			NmeaTransmissionGroup_USR6, "" }));
+	CHECK(!relay.addRule( { sourceGroup, "GPHDTX", "", 0, targetGroup, "" }));
+	CHECK(!relay.addRule( { sourceGroup, "", "", 0, targetGroup,
+			"GW0123456789ABCDE" }));
+}
+
+int main() {
+	expectCycleRejected();
+
+	NmeaRelay relay;
+	CHECK(relay.addRule( { sourceGroup, "??HDT", "", 0, targetGroup, "GW0001" }));
+	CHECK(relay.addRule( { sourceGroup, "GPROT", "GP0001", 0, targetGroup, "" }));
+	CHECK(relay.addRule( { sourceGroup, "??THS", "", 1.0, targetGroup, "GW0001" }));
+
+	MulticastUdp producer = groupSocket(sourceGroup);
+	MulticastUdp receiver = groupSocket(targetGroup);
+	CHECK(producer.open());
+	CHECK(receiver.open());
+	CHECK(relay.start());
+	CHECK(!relay.addRule( { sourceGroup, "", "", 0, NmeaTransmissionGroup_USR8, "" }));
+
+	// Give the relay thread time to join the source group.
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+	// Three line group; the third line comes from another source and matches no rule.
+	std::string grouped = datagram(
+			tagBlock("g:1-3-42,s:GP0001") + "$GPHDT,1.0,T*00\r\n"
+					+ tagBlock("g:2-3-42,s:GP0001") + "$GPROT,2.0,A*00\r\n"
+					+ tagBlock("g:3-3-42,s:TI0001") + "$TIROT,3.0,A*00\r\n");
+	CHECK(producer.send(grouped.data(), grouped.size()) > 0);
+	CHECK(producer.send(grouped.data(), grouped.size()) > 0);
+	for (int i = 0; i < 3; ++i) {
+		std::string ths = datagram(tagBlock("s:HE0001,n:" + std::to_string(i + 1))
+				+ "$HETHS,4.0,A*00\r\n");
+		CHECK(producer.send(ths.data(), ths.size()) > 0);
+	}
+
+	std::vector<std::string> expected = {
+			datagram(tagBlock("s:GW0001,n:1") + "$GPHDT,1.0,T*00\r\n"),
+			datagram(tagBlock("s:GP0001,n:1") + "$GPROT,2.0,A*00\r\n"),
+			datagram(tagBlock("s:GW0001,n:2") + "$GPHDT,1.0,T*00\r\n"),
+			datagram(tagBlock("s:GP0001,n:2") + "$GPROT,2.0,A*00\r\n"),
+			datagram(tagBlock("s:GW0001,n:3") + "$HETHS,4.0,A*00\r\n") };
+
+	char buffer[512];
+	std::vector<std::string> received;
+	int len;
+	while ((len = receiver.recv(buffer, sizeof(buffer))) > 0) {
+		received.push_back(std::string(buffer, len));
+	}
+	relay.stop();
+
+	CHECK(received.size() == expected.size());
+	for (std::size_t i = 0; i < received.size() && i < expected.size(); ++i) {
+		CHECK(received[i] == expected[i]);
+		if (received[i] != expected[i]) {
+			fprintf(stderr, "  %zu: obtenido '%s'\n", i, received[i].c_str() + 6);
+		}
+	}
+	CHECK(relay.forwardedCount() == 5);
+	CHECK(relay.rateLimitedCount() == 2);
+	CHECK(relay.droppedCount() == 0);
+
+	return CHECK_RESULT();
+}
@@ -0,0 +1,73 @@
+/*
+ * sentencedispatcher.cpp
+ *
+ * NmeaSentenceDispatcher routing: formatters with a handler, formatters in the set without one, formatters
+ * outside the set and sentences too short to hold a formatter.
+ */
+
+#include <string>
+#include <vector>
+
+#include "NmeaSentenceDispatcher.h"
+
+#include "check.h"
+
+using namespace NmeaFormatter;
+
+typedef NmeaSentenceDispatcher<HDT, THS, ROT, GGA, VDM> Dispatcher;
+
+int main() {
+	std::vector<std::string> calls;
+	auto record = [&calls](const std::string& name) {
+		return [&calls, name](const std::string& sourceId, const std::string& nmea) {
+			calls.push_back(name + " " + sourceId + " " + nmea);
+		};
+	};
+
+	Dispatcher dispatcher;
+	dispatcher.on<HDT>(record("HDT"));
+	dispatcher.on<GGA>(record("GGA"));
+	dispatcher.on<VDM>(record("VDM"));
+
+	// No fallback yet: only formatters with a handler are routed.
+	CHECK(dispatcher.dispatch("GP0001", "$GPHDT,123.4,T*00"));
+	CHECK(!dispatcher.dispatch("GP0001", "$GPROT,1.0,A*00"));
+	CHECK(!dispatcher.dispatch("GP0001", "$GPXDR,A,1,D,P*00"));
+	CHECK(!dispatcher.dispatch("GP0001", "$GPHD"));
+	CHECK(!dispatcher.dispatch("GP0001", ""));
+	CHECK(calls.size() == 1);
+
+	dispatcher.otherwise(record("otros"));
+	calls.clear();
+	dispatcher.dispatch("GP0001", "$HEHDT,1.0,T*00");
+	dispatcher.dispatch("GP0002", "$GPGGA,120000.00,,,,,0,00,,,M,,M,,*00");
+	dispatcher.dispatch("AI0001", "!AIVDM,1,1,,A,13aEOK?P00PD2wVMdLDRhgvL289?,0*00");
+	dispatcher.dispatch("GP0001", "$GPROT,1.0,A*00");
+	dispatcher.dispatch("GP0001", "$GPTHS,1.0,A*00");
+	dispatcher.dispatch("GP0001", "$GPXDR,A,1,D,P*00");
+	dispatcher.dispatch("GP0001", "$GPHD");
+	dispatcher.dispatch("GP0001", "");
+
+	const char* expected[] = {
+			"HDT GP0001 $HEHDT,1.0,T*00",
+			"GGA GP0002 $GPGGA,120000.00,,,,,0,00,,,M,,M,,*00",
+			"VDM AI0001 !AIVDM,1,1,,A,13aEOK?P00PD2wVMdLDRhgvL289?,0*00",
+			"otros GP0001 $GPROT,1.0,A*00",
+			"otros GP0001 $GPTHS,1.0,A*00",
+			"otros GP0001 $GPXDR,A,1,D,P*00",
+			"otros GP0001 $GPHD",
+			"otros GP0001 " };
+	const std::size_t expectedCount = sizeof(expected) / sizeof(expected[0]);
+	CHECK(calls.size() == expectedCount);
+	for (std::size_t i = 0; i < calls.size() && i < expectedCount; ++i) {
+		CHECK(calls[i] == expected[i]);
+	}
+
+	// Handlers can be replaced, and onStringAvailable routes the same way.
+	calls.clear();
+	dispatcher.on<ROT>(record("ROT"));
+	dispatcher.onStringAvailable("GP0001", "$GPROT,1.0,A*00");
+	CHECK(calls.size() == 1 && calls[0] == "ROT GP0001 $GPROT,1.0,A*00");
+
+	return CHECK_RESULT();
+}
@@ -0,0 +1,98 @@
+/*
+ * sentenceencoder.cpp
+ *
+ * Typed sentence encoders against fixed sentences: rounding, null fields, rejected contents and checksums,
+ * directly and through NmeaDatagramWriter::encodeSentence().
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "NmeaDatagram.h"
+#include "NmeaSentenceEncoder.h"
+
+#include "check.h"
+
+// Checksum computed independently of the encoder, XOR of the characters between '$' and '*'.
+static bool checksumMatches(const std::string& sentence) {
+	std::size_t star = sentence.find('*');
+	if (sentence.empty() || sentence[0] != '$' || star == std::string::npos
+			|| star + 3 != sentence.size()) {
+		return false;
+	}
+	unsigned checksum = 0;
+	for (std::size_t i = 1; i < star; ++i) {
+		checksum ^= static_cast<unsigned char>(sentence[i]);
+	}
+	return checksum == strtoul(sentence.c_str() + star + 1, nullptr, 16);
+}
+
+template<typename Sentence>
+static std::string encode(const char* talker, const Sentence& sentence,
+		std::size_t capacity = NmeaEncodedSentenceMaxSize) {
+	char buffer[NmeaEncodedSentenceMaxSize];
+	std::size_t size = nmeaEncode(buffer, capacity, talker, sentence);
+	return std::string(buffer, size);
+}
+
+static void expect(const std::string& encoded, const char* expected) {
+	CHECK(encoded == expected);
+	if (encoded != expected) {
+		fprintf(stderr, "  obtenido '%s', esperado '%s'\n", encoded.c_str(),
+				expected);
+	}
+	CHECK(encoded.empty() || checksumMatches(encoded));
+}
+
+int main() {
+	expect(encode("HE", NmeaTrueHeading { 123.456 }), "$HEHDT,123.46,T*1D");
+	expect(encode("HE", NmeaTrueHeading { -0.004 }), "$HEHDT,0.00,T*1F");
+	expect(encode("HE", NmeaTrueHeading { 359.999 }), "$HEHDT,0.00,T*1F");
+	expect(encode("HE", NmeaTrueHeading { NAN }), "$HEHDT,,T*01");
+
+	expect(encode("HE", NmeaTrueHeadingStatus { 90.5, 'A' }),
+			"$HETHS,90.50,A*21");
+	expect(encode("HE", NmeaTrueHeadingStatus { 90.5, 'X' }), "");
+	expect(encode("HE", NmeaTrueHeadingStatus { 90.5, '\0' }), "");
+
+	expect(encode("TI", NmeaRateOfTurn { -12.34, true }), "$TIROT,-12.3,A*26");
+	expect(encode("TI", NmeaRateOfTurn { 12000, true }), "$TIROT,,V*02");
+	expect(encode("TI", NmeaRateOfTurn { NAN, true }), "$TIROT,,V*02");
+
+	expect(encode("GP", NmeaPosition { 45296.789, 48.1173, 11.516666667, 1, 8,
+			0.9, 545.4, 46.9, -1, -1 }),
+			"$GPGGA,123456.79,4807.03800,N,01131.00000,E,1,08,0.9,545.4,M,46.9,M,,*6D");
+	expect(encode("GP", NmeaPosition { 0, -33.85, -151.2, 2, 12, 1.25, -10.0,
+			0, 2.5, 23 }),
+			"$GPGGA,000000.00,3351.00000,S,15112.00000,W,2,12,1.3,-10.0,M,0.0,M,2.5,0023*67");
+
+	expect(encode("HE", NmeaTrueHeading { 1 }, NmeaEncodedSentenceMaxSize - 1),
+			"");
+
+	// Encoded in place after the TAG block, followed by the line terminator.
+	char datagram[512];
+	NmeaDatagramWriter writer(datagram, sizeof(datagram));
+	writer.writeTagBlock("HE0001", 6, 1);
+	CHECK(writer.encodeSentence("HE", NmeaTrueHeading { 123.456 }));
+	CHECK(writer.encodeSentence("TI", NmeaRateOfTurn { -12.34, true }));
+	CHECK(!writer.encodeSentence("HE", NmeaTrueHeadingStatus { 1, 'X' }));
+	CHECK(!writer.isValid());
+
+	writer = NmeaDatagramWriter(datagram, sizeof(datagram));
+	writer.writeTagBlock("HE0001", 6, 1);
+	CHECK(writer.encodeSentence("HE", NmeaTrueHeading { 123.456 }));
+	std::string written(datagram, writer.size());
+	CHECK(written.size() > 20
+			&& written.compare(written.size() - 20, 20,
+					"$HEHDT,123.46,T*1D\r\n") == 0);
+
+	NmeaDatagramReader reader(datagram, writer.size());
+	NmeaDatagramLine line;
+	CHECK(reader.next(line));
+	CHECK(std::string(line.sourceId, line.sourceIdSize) == "HE0001");
+	CHECK(std::string(line.sentence, line.sentenceSize) == "$HEHDT,123.46,T*1D");
+
+	return CHECK_RESULT();
+}
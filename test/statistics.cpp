@@ -0,0 +1,144 @@
+/*
+ * statistics.cpp
+ *
+ * NmeaStatistics publisher and NmeaStatisticsReader round trip: counters, consistent snapshots under
+ * concurrent writes, exclusive segments, and a reader following a publisher restart.
+ */
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "NmeaStatistics.h"
+
+#include "check.h"
+
+const NmeaTrasmissionGroupEnum testGroup = NmeaTransmissionGroup_USR2;
+
+int main() {
+	const std::string name = "/NmeaMulticastTest" + std::to_string(getpid());
+
+	NmeaStatisticsReader reader(name);
+	CHECK(!reader.open());
+	CHECK(reader.isReplaced());
+
+	std::unique_ptr<NmeaStatistics> publisher(new NmeaStatistics(name));
+	CHECK(publisher->open());
+	CHECK(!publisher->open());
+
+	publisher->recordDatagram(testGroup, 100, true);
+	publisher->recordDatagram(testGroup, 50, false);
+	publisher->recordSentence(testGroup, "GP0001", 6, 20);
+	publisher->recordSentence(testGroup, "GP0001", 6, 30);
+	publisher->recordSentence(testGroup, "HE0001", 6, 25);
+	publisher->recordDrops(testGroup, 3);
+	publisher->recordKernelDrops(testGroup, 7);
+	publisher->recordDelivery(testGroup, std::chrono::microseconds(0));
+	publisher->recordDelivery(testGroup, std::chrono::microseconds(5));
+
+	CHECK(reader.open());
+	CHECK(!reader.isReplaced());
+	CHECK(reader.publisherPid() == getpid());
+
+	NmeaGroupStatistics statistics;
+	CHECK(reader.snapshot(testGroup, statistics));
+	CHECK(statistics.datagrams == 2);
+	CHECK(statistics.bytes == 150);
+	CHECK(statistics.parseErrors == 1);
+	CHECK(statistics.sentences == 3);
+	CHECK(statistics.drops == 3);
+	CHECK(statistics.kernelDrops == 7);
+	CHECK(statistics.deliveries == 2);
+	CHECK(statistics.latency[0] == 1 && statistics.latency[3] == 1);
+	CHECK(statistics.sourceCount == 2);
+	if (statistics.sourceCount == 2) {
+		CHECK(strcmp(statistics.sources[0].sourceId, "GP0001") == 0);
+		CHECK(statistics.sources[0].sentences == 2);
+		CHECK(statistics.sources[0].bytes == 50);
+		CHECK(strcmp(statistics.sources[1].sourceId, "HE0001") == 0);
+	}
+	CHECK(reader.snapshot(NmeaTransmissionGroup_MISC, statistics));
+	CHECK(statistics.datagrams == 0 && statistics.sourceCount == 0);
+
+	// A second publisher of the same segment is refused while the first one is alive.
+	NmeaStatistics second(name);
+	CHECK(!second.open());
+
+	// Snapshots taken during writes are consistent: every datagram counts 100 bytes.
+	std::atomic<bool> running(true);
+	std::thread writer([&publisher, &running]() {
+		while (running) {
+			publisher->recordDatagram(testGroup, 100, true);
+		}
+	});
+	bool consistent = true;
+	auto stop = std::chrono::steady_clock::now() + std::chrono::milliseconds(200);
+	while (std::chrono::steady_clock::now() < stop) {
+		if (reader.snapshot(testGroup, statistics)
+				&& statistics.bytes != 100 * statistics.datagrams - 50) {
+			consistent = false;
+		}
+	}
+	running = false;
+	writer.join();
+	CHECK(consistent);
+
+	// One writer per group and publisher.
+	auto shared = std::make_shared<NmeaStatistics>(name + "b");
+	CHECK(shared->open());
+	{
+		NmeaMulticastUdp first(testGroup);
+		NmeaMulticastUdp other(testGroup);
+		NmeaMulticastUdp otherGroup(NmeaTransmissionGroup_USR3);
+		CHECK(first.setStatistics(shared));
+		CHECK(!other.setStatistics(shared));
+		CHECK(otherGroup.setStatistics(shared));
+		first.unsetStatistics();
+		CHECK(other.setStatistics(shared));
+	}
+	CHECK(shared->acquireGroup(testGroup));
+	shared->releaseGroup(testGroup);
+
+	// Publisher restart: the reader notices the new segment and starts over from it.
+	publisher.reset();
+	CHECK(reader.isReplaced());
+	publisher.reset(new NmeaStatistics(name));
+	CHECK(publisher->open());
+	CHECK(reader.isReplaced());
+	CHECK(reader.snapshot(testGroup, statistics));
+	CHECK(statistics.datagrams > 2);
+	reader.close();
+	CHECK(reader.open());
+	CHECK(!reader.isReplaced());
+	publisher->recordDatagram(testGroup, 10, true);
+	CHECK(reader.snapshot(testGroup, statistics));
+	CHECK(statistics.datagrams == 1 && statistics.bytes == 10);
+
+	// A segment left behind by a dead publisher is taken over.
+	publisher.reset();
+	reader.close();
+	pid_t child = fork();
+	if (child == 0) {
+		NmeaStatistics orphan(name);
+		_exit(orphan.open() ? 0 : 1);
+	}
+	int status = 0;
+	waitpid(child, &status, 0);
+	CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	CHECK(reader.open());
+	CHECK(reader.publisherPid() == child);
+	publisher.reset(new NmeaStatistics(name));
+	CHECK(publisher->open());
+	CHECK(reader.isReplaced());
+	reader.close();
+	CHECK(reader.open());
+	CHECK(reader.publisherPid() == getpid());
+
+	return CHECK_RESULT();
+}
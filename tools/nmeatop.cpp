@@ -0,0 +1,201 @@
+/*
+ * nmeatop.cpp
+ *
+ * Live view of the statistics published by NmeaStatistics.
+ *
+ * Usage: nmeatop [-i interval_ms] [-n iterations] [segment_name]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "NmeaStatistics.h"
+
+static const char* groupNames[NmeaStatisticsGroupCount] = { "MISC", "TGTD",
+		"SATD", "NAVD", "VDRD", "RCOM", "TIME", "PROP", "USR1", "USR2", "USR3",
+		"USR4", "USR5", "USR6", "USR7", "USR8" };
+
+// A counter lower than before means the publisher restarted, it counts again from zero.
+static double rate(uint64_t current, uint64_t previous, double seconds) {
+	if (current < previous) {
+		previous = 0;
+	}
+	return (current - previous) / seconds;
+}
+
+// Upper bound in microseconds of the bucket holding the given fraction of the deliveries.
+static std::string percentile(const NmeaGroupStatistics& current,
+		const NmeaGroupStatistics& previous, double fraction) {
+	bool restarted = current.deliveries < previous.deliveries;
+	uint64_t total = current.deliveries
+			- (restarted ? 0 : previous.deliveries);
+	if (total == 0) {
+		return "-";
+	}
+	uint64_t target = static_cast<uint64_t>(total * fraction);
+	uint64_t accumulated = 0;
+	for (std::size_t i = 0; i < NmeaStatisticsLatencyBuckets; ++i) {
+		accumulated += current.latency[i]
+				- (restarted ? 0 : previous.latency[i]);
+		if (accumulated > target || i == NmeaStatisticsLatencyBuckets - 1) {
+			if (i == NmeaStatisticsLatencyBuckets - 1) {
+				return ">" + std::to_string(1u << (i - 1));
+			}
+			return "<" + std::to_string(1u << i);
+		}
+	}
+	return "-";
+}
+
+static const NmeaSourceStatistics* findSource(
+		const NmeaGroupStatistics& statistics, const char* sourceId) {
+	for (std::size_t i = 0; i < statistics.sourceCount; ++i) {
+		if (strcmp(statistics.sources[i].sourceId, sourceId) == 0) {
+			return &statistics.sources[i];
+		}
+	}
+	return nullptr;
+}
+
+int main(int argc, char* argv[]) {
+	std::string name = NmeaStatisticsDefaultName;
+	int interval = 1000;
+	long iterations = -1;
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+			interval = std::max(atoi(argv[++i]), 10);
+		} else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			iterations = atol(argv[++i]);
+		} else if (argv[i][0] != '-') {
+			name = argv[i];
+		} else {
+			fprintf(stderr,
+					"Uso: %s [-i intervalo_ms] [-n iteraciones] [segmento]\n",
+					argv[0]);
+			return 1;
+		}
+	}
+
+	NmeaStatisticsReader reader(name);
+	if (!reader.open()) {
+		fprintf(stderr, "No se pudo abrir el segmento '%s'\n", name.c_str());
+		return 1;
+	}
+
+	static NmeaGroupStatistics previous[NmeaStatisticsGroupCount];
+	static NmeaGroupStatistics current[NmeaStatisticsGroupCount];
+	std::chrono::steady_clock::time_point taken[NmeaStatisticsGroupCount];
+	auto start = std::chrono::steady_clock::now();
+	for (std::size_t g = 0; g < NmeaStatisticsGroupCount; ++g) {
+		reader.snapshot(static_cast<NmeaTrasmissionGroupEnum>(g), previous[g]);
+		taken[g] = start;
+	}
+
+	while (iterations != 0) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+
+		// A restarted publisher creates a new segment, the old mapping would stay frozen.
+		if (reader.isReplaced()) {
+			reader.close();
+			if (reader.open()) {
+				auto now = std::chrono::steady_clock::now();
+				for (std::size_t g = 0; g < NmeaStatisticsGroupCount; ++g) {
+					memset(&previous[g], 0, sizeof(previous[g]));
+					taken[g] = now;
+				}
+			}
+		}
+
+		bool valid[NmeaStatisticsGroupCount];
+		for (std::size_t g = 0; g < NmeaStatisticsGroupCount; ++g) {
+			valid[g] = reader.snapshot(static_cast<NmeaTrasmissionGroupEnum>(g),
+					current[g]);
+		}
+		auto now = std::chrono::steady_clock::now();
+
+		if (iterations < 0) {
+			// Clear the terminal, only in continuous mode so the output can be piped.
+			printf("\033[H\033[2J");
+		}
+		if (!reader.isOpen()) {
+			printf("nmeatop - %s - sin publicador\n", name.c_str());
+			fflush(stdout);
+			if (iterations > 0) {
+				--iterations;
+			}
+			continue;
+		}
+		printf("nmeatop - %s - pid %d\n\n", name.c_str(), reader.publisherPid());
+		printf("%-5s %-19s %10s %10s %10s %8s %8s %8s %7s %7s\n", "GROUP",
+				"ADDRESS", "DGRAM/S", "KB/S", "SENT/S", "DROPS", "KDROPS",
+				"PERR", "P50us", "P99us");
+
+		for (std::size_t g = 0; g < NmeaStatisticsGroupCount; ++g) {
+			const NmeaGroupStatistics& c = current[g];
+			const NmeaGroupStatistics& p = previous[g];
+			if (!valid[g]) {
+				// Kept writing during every attempt, or the publisher died mid write. Keep the last good copy.
+				printf("%-5s %-19s %s\n", groupNames[g], "",
+						"lectura inconsistente");
+				continue;
+			}
+			if (c.datagrams == 0 && c.deliveries == 0) {
+				continue;
+			}
+			double seconds = std::chrono::duration<double>(now - taken[g]).count();
+			NmeaTrasmissionGroupEnum group =
+					static_cast<NmeaTrasmissionGroupEnum>(g);
+			std::string address = NmeaMulticastUdp::transmissionGroupAddress(
+					group) + ":"
+					+ std::to_string(
+							NmeaMulticastUdp::transmissionGroupPort(group));
+			printf("%-5s %-19s %10.1f %10.1f %10.1f %8llu %8llu %8llu %7s %7s\n",
+					groupNames[g], address.c_str(),
+					rate(c.datagrams, p.datagrams, seconds),
+					rate(c.bytes, p.bytes, seconds) / 1024.0,
+					rate(c.sentences, p.sentences, seconds),
+					static_cast<unsigned long long>(c.drops),
+					static_cast<unsigned long long>(c.kernelDrops),
+					static_cast<unsigned long long>(c.parseErrors),
+					percentile(c, p, 0.5).c_str(),
+					percentile(c, p, 0.99).c_str());
+
+			for (std::size_t i = 0; i < c.sourceCount; ++i) {
+				const NmeaSourceStatistics& source = c.sources[i];
+				const NmeaSourceStatistics* before = findSource(p,
+						source.sourceId);
+				printf("      %-19s %10s %10.1f %10.1f   total %llu\n",
+						source.sourceId, "",
+						rate(source.bytes, before ? before->bytes : 0, seconds)
+								/ 1024.0,
+						rate(source.sentences, before ? before->sentences : 0,
+								seconds),
+						static_cast<unsigned long long>(source.sentences));
+			}
+			if (c.sourceOverflows > 0) {
+				printf("      %-19s %10s %10s %10s   total %llu\n", "(otros)",
+						"", "", "",
+						static_cast<unsigned long long>(c.sourceOverflows));
+			}
+		}
+		fflush(stdout);
+
+		for (std::size_t g = 0; g < NmeaStatisticsGroupCount; ++g) {
+			if (valid[g]) {
+				previous[g] = current[g];
+				taken[g] = now;
+			}
+		}
+		if (iterations > 0) {
+			--iterations;
+		}
+	}
+
+	return 0;
+}